@@ -205,6 +205,17 @@ bool DeclarativeNgfEvent::isConnected() const
     return client->isConnected();
 }
 
+/*!
+   \qmlproperty NgfClientStats stats
+
+   Statistics of the client shared by all NonGraphicalFeedback items, such as
+   the number of events played and failed. Meant for monitoring.
+ */
+Ngf::ClientStats *DeclarativeNgfEvent::stats() const
+{
+    return client->stats();
+}
+
 void DeclarativeNgfEvent::connectionStatusChanged(bool connected)
 {
     if (connected && m_autostart) {
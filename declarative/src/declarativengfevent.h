@@ -31,6 +31,7 @@
 
 namespace Ngf {
     class Client;
+    class ClientStats;
 }
 
 class DeclarativeNgfEvent : public QObject
@@ -40,6 +41,7 @@ class DeclarativeNgfEvent : public QObject
     Q_PROPERTY(QString event READ event WRITE setEvent NOTIFY eventChanged)
     Q_PROPERTY(EventStatus status READ status NOTIFY statusChanged)
     Q_PROPERTY(QQmlListProperty<DeclarativeNgfEventProperty> properties READ properties)
+    Q_PROPERTY(Ngf::ClientStats *stats READ stats CONSTANT)
     Q_ENUMS(EventStatus)
 
 public:
@@ -60,6 +62,8 @@ public:
 
     EventStatus status() const { return m_status; }
 
+    Ngf::ClientStats *stats() const;
+
     QQmlListProperty<DeclarativeNgfEventProperty> properties();
     void appendProperty(DeclarativeNgfEventProperty*);
     int propertyCount() const;
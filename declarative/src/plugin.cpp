@@ -22,6 +22,7 @@
 #include <QQmlExtensionPlugin>
 #include "declarativengfevent.h"
 #include "declarativengfeventproperty.h"
+#include "ngfclientstats.h"
 
 class Q_DECL_EXPORT NgfPlugin : public QQmlExtensionPlugin
 {
@@ -47,6 +48,8 @@ public:
 
         qmlRegisterType<DeclarativeNgfEvent>(uri, 1, 0, "NonGraphicalFeedback");
         qmlRegisterType<DeclarativeNgfEventProperty>(uri, 1, 0, "NgfProperty");
+        qmlRegisterUncreatableType<Ngf::ClientStats>(uri, 1, 0, "NgfClientStats",
+                                                     QStringLiteral("Statistics are provided by NonGraphicalFeedback"));
     }
 };
 
@@ -8,10 +8,10 @@ INCLUDEPATH += ../src/include
 
 target.path = $$PREFIX/bin
 
-SOURCES += main.cpp
-HEADERS += testing.h
+SOURCES += main.cpp loadgenerator.cpp replayer.cpp
+HEADERS += testing.h loadgenerator.h replayer.h
 
-LIBS += -L../src -lngf-qt
+LIBS += -L../src -lngf-qt$${QT_MAJOR_VERSION}
 
 INSTALLS += target
 
@@ -0,0 +1,229 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QDebug>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+#include "loadgenerator.h"
+
+LoadGenerator::LoadGenerator(const Options &options, QObject *parent)
+    : QObject(parent),
+      m_options(options),
+      m_client(),
+      m_started(false),
+      m_draining(false),
+      m_issued(0),
+      m_skipped(0),
+      m_failures(0),
+      m_completions(0),
+      m_peakInFlight(0),
+      m_playingFor(0)
+{
+    m_ticker.setInterval(1);
+    m_ticker.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&m_ticker, SIGNAL(timeout()), this, SLOT(tick()));
+    m_drainTimer.setSingleShot(true);
+    QObject::connect(&m_drainTimer, SIGNAL(timeout()), this, SLOT(drained()));
+
+    QObject::connect(&m_client, SIGNAL(connectionStatus(bool)), this, SLOT(connected(bool)));
+    QObject::connect(&m_client, SIGNAL(eventPlaying(quint32)), this, SLOT(playing(quint32)));
+    QObject::connect(&m_client, SIGNAL(eventFailed(quint32)), this, SLOT(failed(quint32)));
+    QObject::connect(&m_client, SIGNAL(eventCompleted(quint32)), this, SLOT(completed(quint32)));
+}
+
+void LoadGenerator::start()
+{
+    m_client.connect();
+    if (m_client.isConnected())
+        connected(true);
+}
+
+void LoadGenerator::connected(bool connected)
+{
+    if (!connected) {
+        if (m_started)
+            qWarning() << "Disconnected from NGFD, still playing";
+        return;
+    }
+
+    if (m_started)
+        return;
+
+    qDebug() << "Connected to NGFD, playing" << m_options.rate << "events per second for"
+             << m_options.duration << "seconds";
+    m_started = true;
+    m_clock.start();
+    m_ticker.start();
+}
+
+void LoadGenerator::tick()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+
+    if (!m_draining) {
+        const qint64 end = qint64(m_options.duration) * 1000000000;
+        // Open loop, every play that has fallen due is made however late it is, so that
+        // a slow NGFD shows up in the latencies instead of in fewer plays
+        const qint64 due = qint64(std::floor(double(qMin(now, end - 1)) * m_options.rate / 1e9)) + 1;
+
+        while (m_issued + m_skipped < due) {
+            const qint64 scheduled = qint64(double(m_issued + m_skipped) * 1e9 / m_options.rate);
+
+            if (m_options.concurrency > 0 && m_inFlight.size() >= m_options.concurrency) {
+                ++m_skipped;
+                continue;
+            }
+
+            const quint32 id = m_client.play(nextEvent(), m_options.properties);
+            Play play;
+            play.scheduled = scheduled;
+            play.started = false;
+            m_inFlight.insert(id, play);
+            ++m_issued;
+            m_peakInFlight = qMax(m_peakInFlight, m_inFlight.size());
+        }
+
+        if (now >= end) {
+            m_draining = true;
+            m_playingFor = now;
+            m_drainTimer.start(m_options.drain);
+        }
+    }
+
+    while (!m_held.isEmpty() && m_held.head().first <= now) {
+        const quint32 id = m_held.dequeue().second;
+        if (m_inFlight.contains(id))
+            m_client.stop(id);
+    }
+
+    if (m_draining && m_inFlight.isEmpty())
+        finish();
+}
+
+void LoadGenerator::playing(quint32 id)
+{
+    QHash<quint32, Play>::iterator play = m_inFlight.find(id);
+    if (play == m_inFlight.end() || play->started)
+        return;
+
+    const qint64 now = m_clock.nsecsElapsed();
+    play->started = true;
+    m_latencies.append(now - play->scheduled);
+
+    if (m_options.hold > 0)
+        m_held.enqueue(qMakePair(now + qint64(m_options.hold) * 1000000, id));
+}
+
+void LoadGenerator::failed(quint32 id)
+{
+    if (m_inFlight.remove(id))
+        ++m_failures;
+}
+
+void LoadGenerator::completed(quint32 id)
+{
+    if (m_inFlight.remove(id))
+        ++m_completions;
+}
+
+void LoadGenerator::drained()
+{
+    if (!m_inFlight.isEmpty())
+        qWarning() << m_inFlight.size() << "events still in flight, stopping them";
+
+    finish();
+}
+
+const QString &LoadGenerator::nextEvent()
+{
+    // Smooth weighted round robin, spreads the mix evenly and the same way on every run
+    int total = 0;
+    Event *next = 0;
+
+    for (QList<Event>::iterator event = m_options.mix.begin(); event != m_options.mix.end(); ++event) {
+        event->current += event->weight;
+        total += event->weight;
+        if (!next || event->current > next->current)
+            next = &*event;
+    }
+
+    next->current -= total;
+    return next->name;
+}
+
+void LoadGenerator::finish()
+{
+    if (!m_ticker.isActive())
+        return;
+
+    m_ticker.stop();
+    m_drainTimer.stop();
+
+    report();
+
+    foreach (quint32 id, m_inFlight.keys())
+        m_client.stop(id);
+
+    emit finished();
+}
+
+qint64 LoadGenerator::percentile(double p) const
+{
+    // Nearest rank, m_latencies is sorted
+    if (m_latencies.isEmpty())
+        return 0;
+
+    const int rank = qMax(1, int(std::ceil(p / 100 * m_latencies.size())));
+    return m_latencies.at(rank - 1);
+}
+
+void LoadGenerator::report()
+{
+    std::sort(m_latencies.begin(), m_latencies.end());
+
+    Ngf::ClientStats *stats = m_client.stats();
+    stats->refresh();
+    const QVariantMap reasons = stats->failuresByReason();
+    QStringList failures;
+    for (QVariantMap::const_iterator reason = reasons.constBegin(); reason != reasons.constEnd(); ++reason)
+        failures << QString("%1 %2").arg(reason.key()).arg(reason.value().toULongLong());
+
+    const double seconds = double(m_playingFor) / 1e9;
+    QTextStream out(stdout);
+
+    out << "duration        " << QString::number(seconds, 'f', 2) << " s\n";
+    out << "plays           " << m_issued << " issued, " << m_skipped
+        << " skipped at concurrency limit\n";
+    out << "throughput      " << QString::number(m_issued / seconds, 'f', 1) << " plays/s, target "
+        << m_options.rate << "\n";
+    out << "started         " << m_latencies.size() << "\n";
+    out << "latency [ms]    p50 " << QString::number(percentile(50) / 1e6, 'f', 2)
+        << ", p90 " << QString::number(percentile(90) / 1e6, 'f', 2)
+        << ", p99 " << QString::number(percentile(99) / 1e6, 'f', 2)
+        << ", p99.9 " << QString::number(percentile(99.9) / 1e6, 'f', 2)
+        << ", max " << QString::number(percentile(100) / 1e6, 'f', 2) << "\n";
+    out << "failures        " << m_failures << " (" << failures.join(", ") << ")\n";
+    out << "completions     " << m_completions << "\n";
+    out << "unfinished      " << m_inFlight.size() << "\n";
+    out << "peak in flight  " << m_peakInFlight << "\n";
+}
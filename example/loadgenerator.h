@@ -0,0 +1,105 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QString>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+
+#include <NgfClient>
+
+// Plays events at a fixed rate for a while, whether earlier ones have started or
+// not, and reports how the client and NGFD kept up.
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Event {
+        QString name;
+        int weight;
+        int current;    // Smooth weighted round robin state
+    };
+
+    struct Options {
+        Options() : rate(10), concurrency(0), duration(10), hold(1000), drain(5000) {}
+
+        double rate;        // [plays/s]
+        int concurrency;    // Most events in flight at once, 0 for no limit
+        QList<Event> mix;
+        QVariantMap properties;
+        int duration;       // [s]
+        int hold;           // [ms] Playing events are stopped after this, 0 to let them complete
+        int drain;          // [ms] Time given to events in flight once done playing
+    };
+
+    explicit LoadGenerator(const Options &options, QObject *parent = 0);
+
+    void start();
+
+signals:
+    void finished();
+
+private slots:
+    void connected(bool connected);
+    void tick();
+    void playing(quint32 id);
+    void failed(quint32 id);
+    void completed(quint32 id);
+    void drained();
+
+private:
+    struct Play {
+        qint64 scheduled;   // [ns] When the play was due, latency is measured from this
+        bool started;
+    };
+
+    const QString &nextEvent();
+    void finish();
+    void report();
+    qint64 percentile(double p) const;
+
+    Options m_options;
+    Ngf::Client m_client;
+    QElapsedTimer m_clock;
+    QTimer m_ticker;
+    QTimer m_drainTimer;
+    bool m_started;
+    bool m_draining;
+    qint64 m_issued;
+    qint64 m_skipped;
+    qint64 m_failures;
+    qint64 m_completions;
+    int m_peakInFlight;
+    qint64 m_playingFor;    // [ns] Duration of the playing phase
+    QHash<quint32, Play> m_inFlight;
+    QQueue<QPair<qint64, quint32> > m_held;     // Stop time [ns] and event, oldest first
+    QVector<qint64> m_latencies;                // [ns] From due time to playing
+};
+
+#endif
@@ -19,6 +19,7 @@
  */
 
 #include <QtCore/QCoreApplication>
+#include <QCommandLineParser>
 #include <QTimer>
 #include <QMap>
 #include <QString>
@@ -28,16 +29,148 @@
 
 #include <NgfClient>
 
+#include "loadgenerator.h"
+#include "replayer.h"
 #include "testing.h"
 
+static QVariant propertyValue(const QString &value)
+{
+    // NGFD takes booleans, integers and strings
+    bool isInt = false;
+    const int intValue = value.toInt(&isInt);
+
+    if (isInt)
+        return intValue;
+    if (value == QLatin1String("true") || value == QLatin1String("false"))
+        return value == QLatin1String("true");
+    return value;
+}
+
+static bool parseLoadOptions(const QCommandLineParser &parser, LoadGenerator::Options *options)
+{
+    bool ok = true;
+
+    if (parser.isSet("rate"))
+        options->rate = parser.value("rate").toDouble(&ok);
+    if (!ok || options->rate <= 0) {
+        qWarning() << "Invalid rate" << parser.value("rate");
+        return false;
+    }
+
+    if (parser.isSet("concurrency"))
+        options->concurrency = parser.value("concurrency").toInt(&ok);
+    if (!ok || options->concurrency < 0) {
+        qWarning() << "Invalid concurrency" << parser.value("concurrency");
+        return false;
+    }
+
+    if (parser.isSet("duration"))
+        options->duration = parser.value("duration").toInt(&ok);
+    if (!ok || options->duration <= 0) {
+        qWarning() << "Invalid duration" << parser.value("duration");
+        return false;
+    }
+
+    if (parser.isSet("hold"))
+        options->hold = parser.value("hold").toInt(&ok);
+    if (!ok || options->hold < 0) {
+        qWarning() << "Invalid hold time" << parser.value("hold");
+        return false;
+    }
+
+    // Event mix as name[:weight],...
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const QStringList entries = parser.value("events").split(',', Qt::SkipEmptyParts);
+#else
+    const QStringList entries = parser.value("events").split(',', QString::SkipEmptyParts);
+#endif
+    foreach (const QString &entry, entries) {
+        LoadGenerator::Event event;
+        event.name = entry.section(':', 0, 0);
+        event.weight = entry.contains(':') ? entry.section(':', 1).toInt(&ok) : 1;
+        event.current = 0;
+        if (event.name.isEmpty() || !ok || event.weight <= 0) {
+            qWarning() << "Invalid event" << entry;
+            return false;
+        }
+        options->mix.append(event);
+    }
+    if (options->mix.isEmpty()) {
+        qWarning() << "No events to play";
+        return false;
+    }
+
+    foreach (const QString &property, parser.values("property")) {
+        const int separator = property.indexOf('=');
+        if (separator <= 0) {
+            qWarning() << "Invalid property" << property;
+            return false;
+        }
+        options->properties.insert(property.left(separator),
+                                   propertyValue(property.mid(separator + 1)));
+    }
+
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Plays events through NGFD, as a demo or to load it.");
+    parser.addHelpOption();
+    parser.addOptions(QList<QCommandLineOption>()
+        << QCommandLineOption("load", "Generate load instead of the demo.")
+        << QCommandLineOption("rate", "Plays per second, 10 by default.", "plays")
+        << QCommandLineOption("concurrency", "Most events in flight at once, plays over it are "
+                              "skipped. No limit by default.", "events")
+        << QCommandLineOption("events", "Events to play as name[:weight],..., "
+                              "feedback_press by default.", "mix", "feedback_press")
+        << QCommandLineOption("property", "Property to play the events with, can be "
+                              "repeated.", "key=value")
+        << QCommandLineOption("duration", "Seconds to play for, 10 by default.", "seconds")
+        << QCommandLineOption("hold", "Milliseconds playing events are kept before they are "
+                              "stopped, 0 to let them complete. 1000 by default.", "ms")
+        << QCommandLineOption("replay", "Replay a trace recorded with "
+                              "Ngf::Client::startRecording().", "file")
+        << QCommandLineOption("speed", "Replay speed, 1 for the original timing, 2 for twice "
+                              "as fast, 0 for as fast as possible. 1 by default.", "factor", "1"));
+    parser.process(a);
+
+    if (parser.isSet("replay")) {
+        bool ok = false;
+        const double speed = parser.value("speed").toDouble(&ok);
+        if (!ok || speed < 0) {
+            qWarning() << "Invalid speed" << parser.value("speed");
+            return 1;
+        }
+
+        Replayer replayer;
+        if (!replayer.load(parser.value("replay")))
+            return 1;
+
+        QObject::connect(&replayer, SIGNAL(finished()), &a, SLOT(quit()), Qt::QueuedConnection);
+        replayer.start(speed);
+
+        return a.exec();
+    }
+
+    if (parser.isSet("load")) {
+        LoadGenerator::Options options;
+        if (!parseLoadOptions(parser, &options))
+            return 1;
+
+        LoadGenerator generator(options);
+        QObject::connect(&generator, SIGNAL(finished()), &a, SLOT(quit()), Qt::QueuedConnection);
+        generator.start();
+
+        return a.exec();
+    }
+
     qDebug() << "Start test client.";
 
     Testing t;
 
     return a.exec();
 }
-
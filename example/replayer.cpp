@@ -0,0 +1,230 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QDebug>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "replayer.h"
+
+static bool recordedBefore(const Ngf::TraceRecord &a, const Ngf::TraceRecord &b)
+{
+    return a.time < b.time;
+}
+
+Replayer::Replayer(QObject *parent)
+    : QObject(parent),
+      m_client(),
+      m_next(0),
+      m_speed(1),
+      m_started(false),
+      m_recordedFor(0),
+      m_replayedFor(0),
+      m_recordedFailures(0),
+      m_failures(0),
+      m_completions(0)
+{
+    m_ticker.setInterval(1);
+    m_ticker.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&m_ticker, SIGNAL(timeout()), this, SLOT(tick()));
+    m_drainTimer.setSingleShot(true);
+    QObject::connect(&m_drainTimer, SIGNAL(timeout()), this, SLOT(drained()));
+
+    QObject::connect(&m_client, SIGNAL(connectionStatus(bool)), this, SLOT(connected(bool)));
+    QObject::connect(&m_client, SIGNAL(eventFailed(quint32)), this, SLOT(failed(quint32)));
+    QObject::connect(&m_client, SIGNAL(eventCompleted(quint32)), this, SLOT(completed(quint32)));
+}
+
+bool Replayer::load(const QString &fileName)
+{
+    Ngf::TraceReader reader;
+    if (!reader.open(fileName)) {
+        qWarning() << "Can't read trace" << fileName;
+        return false;
+    }
+
+    Ngf::TraceRecord record;
+    while (reader.next(&record)) {
+        switch (record.type) {
+        case Ngf::TraceRecord::Reply:
+            if (!record.ok)
+                ++m_recordedFailures;
+            break;
+        case Ngf::TraceRecord::Status:
+            if (record.eventId && record.state == 0)
+                ++m_recordedFailures;
+            break;
+        default:
+            m_calls.append(record);
+            break;
+        }
+    }
+
+    if (m_calls.isEmpty()) {
+        qWarning() << "No calls in trace" << fileName;
+        return false;
+    }
+
+    // tick() stops at the first call not yet due, traces written before calls were stamped
+    // in the thread of the client may have them slightly out of order
+    std::stable_sort(m_calls.begin(), m_calls.end(), recordedBefore);
+
+    m_recordedFor = m_calls.last().time - m_calls.first().time;
+    return true;
+}
+
+void Replayer::start(double speed)
+{
+    m_speed = speed;
+    m_client.connect();
+    if (m_client.isConnected())
+        connected(true);
+}
+
+void Replayer::connected(bool connected)
+{
+    if (!connected || m_started)
+        return;
+
+    qDebug() << "Connected to NGFD, replaying" << m_calls.size() << "calls";
+    m_started = true;
+    m_clock.start();
+    m_ticker.start();
+}
+
+void Replayer::tick()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    const qint64 first = m_calls.first().time;
+
+    while (m_next < m_calls.size()) {
+        const Ngf::TraceRecord &record = m_calls.at(m_next);
+        if (m_speed > 0 && double(record.time - first) / m_speed > double(now))
+            break;
+
+        replay(record);
+        ++m_next;
+    }
+
+    if (m_next == m_calls.size()) {
+        // Events the trace left playing are given a while to finish before they are stopped
+        m_ticker.stop();
+        m_replayedFor = now;
+        m_drainTimer.start(m_inFlight.isEmpty() ? 0 : int(DrainTimeout));
+    }
+}
+
+void Replayer::replay(const Ngf::TraceRecord &record)
+{
+    quint32 id = 0;
+
+    switch (record.type) {
+    case Ngf::TraceRecord::Play:
+        id = m_client.play(record.event, record.properties,
+                           Ngf::Client::Priority(record.priority), record.deadline);
+        m_ids.insert(record.eventId, id);
+        m_inFlight.insert(id);
+        return;
+    case Ngf::TraceRecord::PlayOneShot:
+        m_client.playOneShot(record.event, record.properties);
+        return;
+    default:
+        break;
+    }
+
+    // State changes refer to the event by id or by name, like they were made
+    if (record.eventId) {
+        id = m_ids.value(record.eventId);
+        if (!id)
+            return;
+    }
+
+    switch (record.type) {
+    case Ngf::TraceRecord::Pause:
+        if (id)
+            m_client.pause(id);
+        else
+            m_client.pause(record.event);
+        break;
+    case Ngf::TraceRecord::Resume:
+        if (id)
+            m_client.resume(id);
+        else
+            m_client.resume(record.event);
+        break;
+    case Ngf::TraceRecord::Stop:
+        if (id)
+            m_client.stop(id);
+        else
+            m_client.stop(record.event);
+        break;
+    default:
+        break;
+    }
+}
+
+void Replayer::failed(quint32 id)
+{
+    if (!m_inFlight.remove(id))
+        return;
+
+    ++m_failures;
+    if (m_inFlight.isEmpty() && m_drainTimer.isActive())
+        finish();
+}
+
+void Replayer::completed(quint32 id)
+{
+    if (!m_inFlight.remove(id))
+        return;
+
+    ++m_completions;
+    if (m_inFlight.isEmpty() && m_drainTimer.isActive())
+        finish();
+}
+
+void Replayer::drained()
+{
+    finish();
+}
+
+void Replayer::finish()
+{
+    m_drainTimer.stop();
+    report();
+
+    foreach (quint32 id, m_inFlight)
+        m_client.stop(id);
+
+    emit finished();
+}
+
+void Replayer::report()
+{
+    QTextStream out(stdout);
+
+    out << "calls           " << m_calls.size() << "\n";
+    out << "recorded for    " << QString::number(m_recordedFor / 1e9, 'f', 2) << " s\n";
+    out << "replayed in     " << QString::number(m_replayedFor / 1e9, 'f', 2) << " s\n";
+    out << "failures        " << m_failures << ", " << m_recordedFailures << " when recorded\n";
+    out << "completions     " << m_completions << "\n";
+    out << "unfinished      " << m_inFlight.size() << "\n";
+}
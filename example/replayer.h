@@ -0,0 +1,82 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef REPLAYER_H
+#define REPLAYER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+#include <NgfClient>
+
+// Makes the calls of a trace recorded with Ngf::Client::startRecording() again, with the
+// original timing, scaled or as fast as possible. Replies and state changes in the trace
+// are only used for comparison.
+class Replayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Replayer(QObject *parent = 0);
+
+    bool load(const QString &fileName);
+    // Speed 1 keeps the original timing, 2 replays twice as fast, 0 as fast as possible
+    void start(double speed);
+
+signals:
+    void finished();
+
+private slots:
+    void connected(bool connected);
+    void tick();
+    void failed(quint32 id);
+    void completed(quint32 id);
+    void drained();
+
+private:
+    enum { DrainTimeout = 5000 }; // [ms]
+
+    void replay(const Ngf::TraceRecord &record);
+    void finish();
+    void report();
+
+    Ngf::Client m_client;
+    QList<Ngf::TraceRecord> m_calls;
+    int m_next;
+    double m_speed;
+    QElapsedTimer m_clock;
+    QTimer m_ticker;
+    QTimer m_drainTimer;
+    bool m_started;
+    qint64 m_recordedFor;   // [ns] From the first call in the trace to the last
+    qint64 m_replayedFor;   // [ns]
+    int m_recordedFailures;
+    int m_failures;
+    int m_completions;
+    QHash<quint32, quint32> m_ids;  // Recorded client event id to the replayed one
+    QSet<quint32> m_inFlight;
+};
+
+#endif
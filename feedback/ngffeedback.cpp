@@ -61,6 +61,11 @@ NGFFeedback::NGFFeedback(QObject *parent)
     m_effects[QFeedbackEffect::Appear] = QString();
     m_effects[QFeedbackEffect::Disappear] = QString();
     m_effects[QFeedbackEffect::Move] = QString();
+
+    for (int i = 0; i < QFeedbackEffect::NumberOfEffects; ++i) {
+        if (!m_effects[i].isEmpty())
+            m_preparedEffects[i] = m_client.prepare(m_effects[i]);
+    }
 }
 
 NGFFeedback::~NGFFeedback()
@@ -103,7 +108,6 @@ void NGFFeedback::paused(quint32 id)
 
 bool NGFFeedback::play(QFeedbackEffect::Effect effect)
 {
-    quint32 id;
     switch (effect) {
     case QFeedbackEffect::Press:
     case QFeedbackEffect::Release:
@@ -116,12 +120,11 @@ bool NGFFeedback::play(QFeedbackEffect::Effect effect)
     case QFeedbackEffect::DragDropOutOfZone:
     case QFeedbackEffect::DragCrossBoundary:
         /* These are quick effects and the status can not be retrieved
-         * via effectState() anyway, thus this is not storing the id.
+         * via effectState() anyway, thus these are not followed at all.
          */
-        id = m_client.play(m_effects[effect]);
-        if (!id)
+        if (!m_client.playOneShot(m_preparedEffects[effect]))
             qCWarning(ngflc) << "Could not play effect";
-        qCDebug(ngflc) << "Playing effect #" << effect << "(" << m_effects[effect] << ") with id" << id;
+        qCDebug(ngflc) << "Playing effect #" << effect << "(" << m_effects[effect] << ")";
         return true;
     case QFeedbackEffect::Appear:
     case QFeedbackEffect::Disappear:
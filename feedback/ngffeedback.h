@@ -78,6 +78,7 @@ private:
 
     Ngf::Client m_client;
     QString m_effects[QFeedbackEffect::NumberOfEffects];
+    Ngf::PreparedEvent m_preparedEffects[QFeedbackEffect::NumberOfEffects];
 };
 
 #endif // NGF_FEEDBACK_H
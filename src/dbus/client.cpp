@@ -20,6 +20,7 @@
 
 #include <QObject>
 #include <QDebug>
+#include <QDBusConnection>
 
 #include "ngfclient.h"
 #include "clientprivate.h"
@@ -31,14 +32,47 @@ Ngf::Client::Client(QObject *parent)
 
 Ngf::Client::~Client()
 {
+    // Dispatcher thread emits signals of this object until it is stopped
+    d_ptr->stopDispatcherThread();
     delete d_ptr;
 }
 
+bool Ngf::Client::openPrivateConnection(BusType bus, const QString &name)
+{
+    return d_ptr->openPrivateConnection(QDBusConnection::connectToBus(
+            bus == SessionBus ? QDBusConnection::SessionBus : QDBusConnection::SystemBus, name));
+}
+
+bool Ngf::Client::openPrivateConnection(const QString &address, const QString &name)
+{
+    return d_ptr->openPrivateConnection(QDBusConnection::connectToBus(address, name));
+}
+
+bool Ngf::Client::openPeerConnection(const QString &address)
+{
+    return d_ptr->openPeerConnection(address);
+}
+
+bool Ngf::Client::openLoopback(int replyDelay, int statusDelay, int duration)
+{
+    return d_ptr->openLoopback(replyDelay, statusDelay, duration);
+}
+
+bool Ngf::Client::startDispatcherThread()
+{
+    return d_ptr->startDispatcherThread();
+}
+
 bool Ngf::Client::connect()
 {
     return d_ptr->connect();
 }
 
+void Ngf::Client::warmUp(bool ping)
+{
+    d_ptr->warmUp(ping);
+}
+
 bool Ngf::Client::isConnected()
 {
     return d_ptr->isConnected();
@@ -59,6 +93,53 @@ quint32 Ngf::Client::play(const QString &event, const QMap<QString, QVariant> &p
     return d_ptr->play(event, properties);
 }
 
+quint32 Ngf::Client::play(const QString &event, const QMap<QString, QVariant> &properties,
+                          int deadline)
+{
+    return d_ptr->play(event, properties, deadline);
+}
+
+quint32 Ngf::Client::play(const QString &event, const QMap<QString, QVariant> &properties,
+                          Priority priority, int deadline)
+{
+    return d_ptr->play(event, properties, priority, deadline);
+}
+
+QList<quint32> Ngf::Client::playBatch(const QList<EventRequest> &requests)
+{
+    return d_ptr->playBatch(requests);
+}
+
+Ngf::PreparedEvent Ngf::Client::prepare(const QString &event)
+{
+    return d_ptr->prepare(event, QMap<QString, QVariant>());
+}
+
+Ngf::PreparedEvent Ngf::Client::prepare(const QString &event, const QMap<QString, QVariant> &properties)
+{
+    return d_ptr->prepare(event, properties);
+}
+
+quint32 Ngf::Client::play(const PreparedEvent &event)
+{
+    return d_ptr->play(event);
+}
+
+bool Ngf::Client::playOneShot(const PreparedEvent &event)
+{
+    return d_ptr->playOneShot(event);
+}
+
+bool Ngf::Client::playOneShot(const QString &event)
+{
+    return d_ptr->playOneShot(event, QMap<QString, QVariant>());
+}
+
+bool Ngf::Client::playOneShot(const QString &event, const QMap<QString, QVariant> &properties)
+{
+    return d_ptr->playOneShot(event, properties);
+}
+
 bool Ngf::Client::pause(quint32 event_id)
 {
     return d_ptr->pause(event_id);
@@ -88,3 +169,53 @@ bool Ngf::Client::stop(const QString &event)
 {
     return d_ptr->stop(event);
 }
+
+void Ngf::Client::setRateLimit(const QString &event, int interval, int burst)
+{
+    d_ptr->setRateLimit(event, interval, burst);
+}
+
+QVariantMap Ngf::Client::statistics() const
+{
+    return d_ptr->statistics();
+}
+
+Ngf::ClientStats *Ngf::Client::stats()
+{
+    return d_ptr->stats();
+}
+
+bool Ngf::Client::startRecording(const QString &fileName)
+{
+    return d_ptr->startRecording(fileName);
+}
+
+bool Ngf::Client::stopRecording()
+{
+    return d_ptr->stopRecording();
+}
+
+QString Ngf::Client::dumpFlightRecorder() const
+{
+    return d_ptr->dumpFlightRecorder();
+}
+
+bool Ngf::Client::dumpFlightRecordersOnSignal(int signal)
+{
+    return FlightRecorder::dumpOnSignal(signal);
+}
+
+void Ngf::Client::setTimelinesEnabled(bool enabled)
+{
+    d_ptr->setTimelinesEnabled(enabled);
+}
+
+QVariantMap Ngf::Client::timeline(quint32 event_id) const
+{
+    return d_ptr->timeline(event_id);
+}
+
+QVariantMap Ngf::Client::latencies() const
+{
+    return d_ptr->latencies();
+}
@@ -19,138 +19,368 @@
  */
 
 #include <QObject>
+#include <QMutexLocker>
+#include <QThread>
 #include <QTimer>
-#include <QtDBus>
 #include <QList>
 #include <QtAlgorithms>
+#include <algorithm>
 #include "clientprivate.h"
-
-namespace Ngf
-{
-    enum NgfStatusId
-    {
-        StatusEventFailed       = 0,
-        StatusEventCompleted    = 1,
-        StatusEventPlaying      = 2,
-        StatusEventPaused       = 3,
-    };
-
-    const static QString NgfDestination     = "com.nokia.NonGraphicFeedback1.Backend";
-    const static QString NgfPath            = "/com/nokia/NonGraphicFeedback1";
-    const static QString NgfInterface       = "com.nokia.NonGraphicFeedback1";
-    const static QString MethodPlay         = "Play";
-    const static QString MethodStop         = "Stop";
-    const static QString MethodPause        = "Pause";
-    const static QString SignalStatus       = "Status";
-
-    class Event
-    {
-    public:
-        Event(const QString &_name, quint32 _clientEventId, QDBusPendingCallWatcher *_watcher)
-            : name(_name), clientEventId(_clientEventId), serverEventId(0),
-              wantedState(ClientPrivate::StatePlaying),
-              activeState(ClientPrivate::StateNew),
-              pendingState(ClientPrivate::StateNew),
-              watcher(_watcher)
-        {}
-        ~Event() {}
-
-        QString name;
-        quint32 clientEventId;
-        quint32 serverEventId;
-        ClientPrivate::EventState wantedState;
-        ClientPrivate::EventState activeState;
-        ClientPrivate::EventState pendingState;
-        QDBusPendingCallWatcher *watcher;
-    };
-}
-
-QDBusMessage createMethodCall(const QString &method)
-{
-    return QDBusMessage::createMethodCall(Ngf::NgfDestination, Ngf::NgfPath, Ngf::NgfInterface, method);
-}
+#include "commandqueue.h"
+#include "dbustransport.h"
+#include "eventpool.h"
+#include "loopbacktransport.h"
+#include "ngfclientstats.h"
+#include "preparedeventprivate.h"
+#include "timeline.h"
+#include "tracepoints.h"
+#include "tracewriter.h"
 
 Ngf::ClientPrivate::ClientPrivate(Client *parent)
     : QObject(parent),
       q_ptr(parent),
       m_log("ngf.client"),
-      m_serviceWatcher(0),
+      m_transport(0),
+      m_watchWanted(false),
+      m_watching(false),
       m_connected(false),
-      m_clientEventId(0)
+      m_warmUpPending(false),
+      m_warmUpPing(false),
+      m_clientEventId(0),
+      m_commands(new CommandQueue),
+      m_drainScheduled(0),
+      m_draining(false),
+      m_queuedCalls(0),
+      m_clientThread(0),
+      m_dispatcher(0),
+      m_pool(new EventPool),
+      m_backgroundCalls(0),
+      m_dispatchScheduled(false),
+      m_elidedCalls(0),
+      m_serviceState(ServiceUnknown),
+      m_parkedTimer(new QTimer(this)),
+      m_offlineQueued(0),
+      m_offlineDropped(0),
+      m_deadlineTimer(new QTimer(this)),
+      m_deadlineDropped(0),
+      m_statusWanted(false),
+      m_statusFollowed(false),
+      m_idleTimer(new QTimer(this)),
+      m_statusReceived(0),
+      m_statusMatched(0),
+      m_playsIssued(0),
+      m_replies(0),
+      m_replyFailures(0),
+      m_statusFailures(0),
+      m_completions(0),
+      m_pendingCalls(0),
+      m_eventsPeak(0),
+      m_stats(0),
+      m_statsTimer(new QTimer(this)),
+      m_rateLimited(0),
+      m_suppressedCalls(0),
+      m_timelinesEnabled(0),
+      m_timelines(new Timelines),
+      m_recorder(0),
+      m_recordingFailed(false),
+      m_flightRecorder(m_clock),
+      m_batchId(0)
 {
     m_log.setEnabled(QtDebugMsg, false);
+
+    for (int i = 0; i < PriorityCount; ++i)
+        m_stagedPeak[i] = 0;
+
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(IdleStatusTimeout);
+    QObject::connect(m_idleTimer, SIGNAL(timeout()), this, SLOT(dropStatus()));
+
+    m_parkedTimer->setSingleShot(true);
+    QObject::connect(m_parkedTimer, SIGNAL(timeout()), this, SLOT(expireParked()));
+    m_deadlineTimer->setSingleShot(true);
+    m_deadlineTimer->setTimerType(Qt::PreciseTimer);
+    QObject::connect(m_deadlineTimer, SIGNAL(timeout()), this, SLOT(expireCalls()));
+    m_statsTimer->setSingleShot(true);
+    m_statsTimer->setInterval(StatsInterval);
+    QObject::connect(m_statsTimer, SIGNAL(timeout()), this, SLOT(publishStats()));
+    m_clock.start();
+
+    // Loopback lets applications run, and tests and benchmarks drive the client, without NGFD
+    if (qgetenv("NGF_TRANSPORT") == "loopback")
+        setTransport(new LoopbackTransport(this, 0, 0, -1));
+    else
+        setTransport(new DBusTransport(this));
 }
 
 Ngf::ClientPrivate::~ClientPrivate()
 {
+    stopDispatcherThread();
     disconnect();
     removeAllEvents();
+    delete m_commands;
+    delete m_transport;
+    delete m_pool;
+    delete m_timelines;
+    delete m_recorder;
+}
+
+void Ngf::ClientPrivate::setTransport(Transport *transport)
+{
+    delete m_transport;
+    m_transport = transport;
+
+    QObject::connect(m_transport, SIGNAL(status(quint32,quint32)),
+                     this, SLOT(setEventState(quint32,quint32)));
+    QObject::connect(m_transport, SIGNAL(serviceLost()),
+                     this, SLOT(serviceLost()));
+    QObject::connect(m_transport, SIGNAL(serviceAvailable(bool)),
+                     this, SLOT(serviceAvailable(bool)));
+    QObject::connect(m_transport, SIGNAL(servicePresent(bool)),
+                     this, SLOT(servicePresent(bool)));
+}
+
+bool Ngf::ClientPrivate::checkUnused(const char *warning)
+{
+    // Slots still in use may have a call in flight on the current transport
+    if (m_watchWanted || m_pool->used() > 0 || m_dispatcher) {
+        qCWarning(m_log) << warning;
+        return false;
+    }
+
+    return true;
+}
+
+bool Ngf::ClientPrivate::openPrivateConnection(const QDBusConnection &connection)
+{
+    DBusTransport *dbus = qobject_cast<DBusTransport*>(m_transport);
+
+    if (!dbus) {
+        qCWarning(m_log) << "Private connection can't be used with loopback transport.";
+        QDBusConnection::disconnectFromBus(connection.name());
+        return false;
+    }
+
+    if (!checkUnused("Private connection must be opened before connecting, playing events or starting dispatcher thread.")) {
+        QDBusConnection::disconnectFromBus(connection.name());
+        return false;
+    }
+
+    return dbus->openPrivateConnection(connection);
+}
+
+bool Ngf::ClientPrivate::openPeerConnection(const QString &address)
+{
+    DBusTransport *dbus = qobject_cast<DBusTransport*>(m_transport);
+
+    if (!dbus) {
+        qCWarning(m_log) << "Peer connection can't be used with loopback transport.";
+        return false;
+    }
+
+    if (!checkUnused("Peer connection must be opened before connecting, playing events or starting dispatcher thread."))
+        return false;
+
+    return dbus->openPeerConnection(address);
+}
+
+bool Ngf::ClientPrivate::openLoopback(int replyDelay, int statusDelay, int duration)
+{
+    if (!checkUnused("Loopback must be opened before connecting, playing events or starting dispatcher thread."))
+        return false;
+
+    setTransport(new LoopbackTransport(this, replyDelay, statusDelay, duration));
+    qCDebug(m_log) << "using loopback transport" << replyDelay << statusDelay << duration;
+
+    return true;
+}
+
+bool Ngf::ClientPrivate::startDispatcherThread()
+{
+    if (!checkUnused("Dispatcher thread must be started before connecting or playing events."))
+        return false;
+
+    // Requests from the client thread go through the command queue from now on, and
+    // replies and status are handled in the dispatcher thread
+    m_clientThread = thread();
+    m_dispatcher = new QThread;
+    m_dispatcher->setObjectName(QStringLiteral("ngf-dispatcher"));
+    m_dispatcher->start();
+
+    setParent(0);
+    moveToThread(m_dispatcher);
+
+    qCDebug(m_log) << "dispatcher thread started";
+
+    return true;
+}
+
+void Ngf::ClientPrivate::stopDispatcherThread()
+{
+    if (!m_dispatcher)
+        return;
+
+    // Come back from the dispatcher thread, so that the client can be torn down in its own
+    // thread without anything arriving from the dispatcher meanwhile
+    QMetaObject::invokeMethod(this, "returnToClientThread", Qt::BlockingQueuedConnection);
+    m_dispatcher->quit();
+    m_dispatcher->wait();
+    delete m_dispatcher;
+    m_dispatcher = 0;
+
+    qCDebug(m_log) << "dispatcher thread stopped";
+}
+
+void Ngf::ClientPrivate::returnToClientThread()
+{
+    moveToThread(m_clientThread);
 }
 
 bool Ngf::ClientPrivate::connect()
 {
-    if (!m_serviceWatcher) {
-        m_serviceWatcher = new QDBusServiceWatcher(NgfDestination,
-                                                   QDBusConnection::systemBus(),
-                                                   QDBusServiceWatcher::WatchForUnregistration,
-                                                   this);
+    if (!isOwnerThread()) {
+        bool connected = false;
+        QMetaObject::invokeMethod(this, "connect", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, connected));
+        return connected;
+    }
+
+    flushCommands();
+
+    // Watching NGFD is set up on the first dispatch, applications connecting at startup
+    // don't pay for it unless they play something
+    m_watchWanted = true;
+
+    changeConnected(m_serviceState != ServiceAbsent);
+    return m_connected;
+}
+
+void Ngf::ClientPrivate::warmUp(bool ping)
+{
+    // Caller doesn't wait for any of it, also when calling from another thread
+    QMetaObject::invokeMethod(this, "startWarmUp", Qt::QueuedConnection, Q_ARG(bool, ping));
+}
+
+void Ngf::ClientPrivate::startWarmUp(bool ping)
+{
+    m_watchWanted = true;
+    m_warmUpPending = true;
+    m_warmUpPing = ping;
+    prepareTransport();
+    m_transport->warmUp(ping);
+}
 
-        QObject::connect(m_serviceWatcher, SIGNAL(serviceUnregistered(const QString&)),
-                         this, SLOT(serviceUnregistered(const QString&)));
+void Ngf::ClientPrivate::serviceAvailable(bool available)
+{
+    qCDebug(m_log) << "NGFD" << (available ? "available" : "not available");
 
-        QDBusConnection::systemBus().connect(QString(), NgfPath, NgfInterface, SignalStatus,
-                                             this, SLOT(setEventState(quint32,quint32)));
+    changeConnected(available);
+    if (available) {
+        m_warmUpPending = false;
+        emit q_ptr->ready();
     }
+}
 
-    // connected doesn't mean much really, mostly just backward compatibility
+void Ngf::ClientPrivate::servicePresent(bool present)
+{
+    if (!present) {
+        // Without watching there would be no telling when NGFD is back
+        if (m_watching && m_serviceState != ServiceAbsent) {
+            qCDebug(m_log) << "NGFD not on the bus, holding back plays";
+            m_serviceState = ServiceAbsent;
+            changeConnected(false);
+        }
+        return;
+    }
+
+    m_serviceState = ServicePresent;
     changeConnected(true);
-    return m_connected;
+
+    // Warm-up made before NGFD was up is finished now, with the round trip if one was asked for
+    if (m_warmUpPending) {
+        if (m_warmUpPing) {
+            m_transport->warmUp(true);
+        } else {
+            m_warmUpPending = false;
+            emit q_ptr->ready();
+        }
+    }
+
+    unparkAll();
 }
 
 void Ngf::ClientPrivate::disconnect()
 {
+    if (!isOwnerThread()) {
+        QMetaObject::invokeMethod(this, "disconnect", Qt::BlockingQueuedConnection);
+        return;
+    }
+
     changeConnected(false);
 }
 
-void Ngf::ClientPrivate::serviceUnregistered(const QString &service)
+void Ngf::ClientPrivate::serviceLost()
 {
-    Q_UNUSED(service);
-
-    // All currently active events are invalid, so clear event list
-    removeAllEvents();
+    // Events running in NGFD went away with it. Those not sent yet are parked by dispatch()
+    // and those with the Play call in flight by playReply(), once NGFD is known to be absent.
+    // Signal handlers may remove further events, so they are looked up one at a time.
+    foreach (quint32 clientEventId, m_events.keys()) {
+        Event *event = m_events.value(clientEventId);
+        if (event && !event->staged && !event->parked && !event->callPending)
+            failEvent(event, m_offlineDropped);
+    }
 }
 
 bool Ngf::ClientPrivate::isConnected()
 {
+    if (!isOwnerThread()) {
+        bool connected = false;
+        QMetaObject::invokeMethod(this, "isConnected", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, connected));
+        return connected;
+    }
+
     return m_connected;
 }
 
 void Ngf::ClientPrivate::setEventState(quint32 serverEventId, quint32 state)
 {
-    Event *event = 0;
+    // Match serverEventId to internal clientEventId. In case of failing or completing
+    // event, we'll also remove that event from event list later.
+    Event *event = m_serverEvents.value(serverEventId);
+    m_flightRecorder.record(FlightRecorder::Status, event ? event->clientEventId : 0,
+                            serverEventId, state);
 
-    // Look through all ongoing events and match serverEventId to internal clientEventId.
-    // In case of failing or completing event, we'll also remove that event from event list later.
-    for (int i = 0; i < m_events.size(); ++i) {
-        Event *e = m_events.at(i);
-        if (e->serverEventId == serverEventId) {
-            event = e;
-            break;
-        }
+    if (m_recorder) {
+        TraceRecord record;
+        record.type = TraceRecord::Status;
+        record.time = m_clock.nsecsElapsed();
+        record.serverEventId = serverEventId;
+        record.state = state;
+        record.eventId = event ? event->clientEventId : 0;
+        writeTrace(record);
     }
 
+    ++m_statusReceived;
     if (!event)
         return;
+    ++m_statusMatched;
+    touchStats();
+    NGF_TRACE3(status, event->clientEventId, serverEventId, state);
+
+    if (timelinesEnabled())
+        m_timelines->status(event->clientEventId, state, m_clock.nsecsElapsed());
 
     qCDebug(m_log) << event->clientEventId << "server state" << state;
 
     switch (state) {
         case StatusEventFailed:
+            ++m_statusFailures;
             event->activeState = StateStopped;
             emit q_ptr->eventFailed(event->clientEventId);
             break;
 
         case StatusEventCompleted:
+            ++m_completions;
             event->activeState = StateStopped;
             emit q_ptr->eventCompleted(event->clientEventId);
             break;
@@ -171,6 +401,7 @@ void Ngf::ClientPrivate::setEventState(quint32 serverEventId, quint32 state)
             // Undefined state received from NGFD, probably server
             // DBus API has changed and we are out of sync.
             qCWarning(m_log) << "Client received unknown event state id, likely NGFD API has changed. state:" << state;
+            ++m_statusFailures;
             event->activeState = StateStopped;
             emit q_ptr->eventFailed(event->clientEventId);
             removeEvent(event);
@@ -194,65 +425,675 @@ quint32 Ngf::ClientPrivate::play(const QString &event)
 
 quint32 Ngf::ClientPrivate::play(const QString &event, const Proplist &properties)
 {
-    ++m_clientEventId;
+    return requestPlay(event, properties, QDBusMessage(), 0, Client::NormalPriority);
+}
+
+quint32 Ngf::ClientPrivate::play(const QString &event, const Proplist &properties, int deadline)
+{
+    return requestPlay(event, properties, QDBusMessage(), deadline, Client::NormalPriority);
+}
 
-    // Create asynchronic call to NGFD and connect pending call watcher to slot
-    // playPendingReply where it is finally determined if event is really running
-    // in the NGFD side.
-    QDBusMessage play = createMethodCall(MethodPlay);
-    play << event << properties;
+quint32 Ngf::ClientPrivate::play(const QString &event, const Proplist &properties,
+                                 Client::Priority priority, int deadline)
+{
+    return requestPlay(event, properties, QDBusMessage(), deadline, priority);
+}
 
-    QDBusPendingCall pending = QDBusConnection::systemBus().asyncCall(play);
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pending, 0);
-    Event *e = new Event(event, m_clientEventId, watcher);
-    m_events.push_back(e);
+quint32 Ngf::ClientPrivate::play(const PreparedEvent &event)
+{
+    if (!event.isValid()) {
+        qCWarning(m_log) << "Can't play invalid prepared event.";
+        return 0;
+    }
 
-    QObject::connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
-                     this, SLOT(playPendingReply(QDBusPendingCallWatcher*)));
+    return requestPlay(event.d->name, event.d->properties, event.d->message, 0,
+                       Client::NormalPriority);
+}
+
+QList<quint32> Ngf::ClientPrivate::playBatch(const QList<EventRequest> &requests)
+{
+    QList<quint32> clientEventIds;
+    QList<quint32> playedIds;
+    QList<EventRequest> played;
+
+    if (requests.isEmpty())
+        return clientEventIds;
+
+    foreach (const EventRequest &request, requests) {
+        if (allowPlay(request.event)) {
+            clientEventIds.append(nextClientEventId());
+            playedIds.append(clientEventIds.last());
+            m_flightRecorder.record(FlightRecorder::Play, clientEventIds.last(), 0,
+                                    Client::NormalPriority);
+            played.append(request);
+        } else {
+            clientEventIds.append(Client::SuppressedEventId);
+        }
+    }
+
+    if (played.isEmpty())
+        return clientEventIds;
+
+    // Deadlines count from the call, also when the batch is queued from another thread
+    const qint64 issued = m_clock.nsecsElapsed();
+
+    if (isOwnerThread()) {
+        flushCommands();
+        stageBatch(playedIds, played, issued);
+    } else {
+        post(new Command(playedIds, played, issued));
+    }
+
+    return clientEventIds;
+}
+
+void Ngf::ClientPrivate::stageBatch(const QList<quint32> &clientEventIds,
+                                    const QList<EventRequest> &requests, qint64 issued)
+{
+    // Everything is staged in one go, so the whole batch goes out in the same dispatch
+    Batch &batch = m_batches[++m_batchId];
+    batch.clientEventIds = clientEventIds;
+    batch.unanswered = requests.size();
+
+    for (int i = 0; i < requests.size(); ++i) {
+        stagePlay(clientEventIds.at(i), requests.at(i).event, requests.at(i).properties,
+                  QDBusMessage(), deadlineAt(issued, requests.at(i).deadline),
+                  Client::NormalPriority, issued);
+        m_events.value(clientEventIds.at(i))->batchId = m_batchId;
+    }
+
+    qCDebug(m_log) << "batch" << m_batchId << "events" << clientEventIds;
+}
+
+Ngf::PreparedEvent Ngf::ClientPrivate::prepare(const QString &event, const Proplist &properties)
+{
+    return PreparedEvent(new PreparedEventPrivate(event, properties,
+                                                  m_transport->prepare(event, properties)));
+}
+
+qint64 Ngf::ClientPrivate::deadlineAt(qint64 issued, int deadline) const
+{
+    // Clock starts with the client, so any real deadline is well above zero
+    return deadline > 0 ? issued / 1000000 + deadline : 0;
+}
+
+quint32 Ngf::ClientPrivate::requestPlay(const QString &event, const Proplist &properties,
+                                        const QDBusMessage &play, int deadline,
+                                        Client::Priority priority)
+{
+    if (!allowPlay(event))
+        return Client::SuppressedEventId;
+
+    // Id is handed out right away, also when the play itself is queued from another thread
+    const quint32 clientEventId = nextClientEventId();
+    const qint64 issued = m_clock.nsecsElapsed();
+    const qint64 deadlineTime = deadlineAt(issued, deadline);
+    NGF_TRACE3(play, clientEventId, int(priority), deadlineTime);
+    m_flightRecorder.record(FlightRecorder::Play, clientEventId, 0, priority);
+
+    if (isOwnerThread()) {
+        flushCommands();
+        stagePlay(clientEventId, event, properties, play, deadlineTime, priority, issued);
+    } else {
+        post(new Command(Command::Play, clientEventId, event, StateNew, properties, play,
+                         deadlineTime, priority, issued));
+    }
+
+    return clientEventId;
+}
+
+void Ngf::ClientPrivate::stagePlay(quint32 clientEventId, const QString &event,
+                                   const Proplist &properties, const QDBusMessage &play,
+                                   qint64 deadline, Client::Priority priority, qint64 issued)
+{
+    // Status subscription has to be in place before Play goes out, see prepareTransport()
+    m_idleTimer->stop();
+    m_statusWanted = true;
+
+    Event *e = m_pool->acquire(event, clientEventId);
+    m_events.insert(e->clientEventId, e);
+    m_eventsPeak = qMax(m_eventsPeak, m_events.size());
+    ++m_playsIssued;
+    touchStats();
+    m_namedEvents[e->name].append(e);
+
+    // Actual call is made in dispatch(), after the caller has had the chance to change its mind
+    e->properties = properties;
+    e->message = play;
+    e->deadline = deadline;
+    e->priority = priority;
+    stage(e);
+    scheduleDispatch();
+
+    if (timelinesEnabled())
+        m_timelines->played(e->clientEventId, e->name, issued);
+
+    if (m_recorder) {
+        TraceRecord record;
+        // Stamped when carried out like the other calls, so that the trace stays in order
+        // with plays queued from other threads
+        record.type = TraceRecord::Play;
+        record.time = m_clock.nsecsElapsed();
+        record.eventId = e->clientEventId;
+        record.event = e->name;
+        record.properties = properties;
+        record.priority = priority;
+        record.deadline = deadline ? int(deadline - record.time / 1000000) : 0;
+        writeTrace(record);
+    }
 
     qCDebug(m_log) << e->clientEventId << "set state" << e->wantedState;
+}
 
-    return e->clientEventId;
+void Ngf::ClientPrivate::stage(Event *event)
+{
+    QList<Event*> &queue = m_staged[event->priority];
+
+    event->staged = true;
+    queue.append(event);
+    if (queue.size() > m_stagedPeak[event->priority])
+        m_stagedPeak[event->priority] = queue.size();
 }
 
-void Ngf::ClientPrivate::playPendingReply(QDBusPendingCallWatcher *watcher)
+bool Ngf::ClientPrivate::isOwnerThread() const
 {
-    QDBusPendingReply<quint32> reply = *watcher;
-    int i = 0;
+    return QThread::currentThread() == thread();
+}
 
-    // Play -method reply should contain one argument of type uint32 containing
-    // server side event id for started event.
+quint32 Ngf::ClientPrivate::nextClientEventId()
+{
+    return m_clientEventId.fetchAndAddRelaxed(1) + 1;
+}
 
-    for (i = 0; i < m_events.size(); ++i) {
-        Event *event = m_events.at(i);
-        if (event->watcher == watcher) {
-            if (reply.isError() || reply.count() != 1) {
-                // Starting event failed for some reason, reason can hopefully be determined from
-                // NGFD logs.
-                quint32 clientEventId = event->clientEventId;
-                removeEvent(event);
-                qCDebug(m_log) << clientEventId << "play: operation failed";
-                emit q_ptr->eventFailed(clientEventId);
-            } else {
-                event->serverEventId = reply.argumentAt<0>();
-                event->watcher = 0;
-                event->activeState = StatePlaying;
-                qCDebug(m_log) << event->clientEventId << "play: server replied" << event->serverEventId;
-                emit q_ptr->eventPlaying(event->clientEventId);
+void Ngf::ClientPrivate::setRateLimit(const QString &event, int interval, int burst)
+{
+    QMutexLocker locker(&m_rateMutex);
 
-                if (event->pendingState != StateNew) {
-                    qCDebug(m_log) << event->clientEventId
-                                   << "wanted state" << event->pendingState
-                                   << "differs from active state" << event->activeState;
-                    requestEventState(event, event->pendingState);
-                    event->pendingState = StateNew;
-                }
-            }
+    if (interval > 0) {
+        RateLimit limit;
+        limit.interval = interval;
+        limit.tolerance = qint64(qMax(burst, 1) - 1) * interval;
+        limit.nextDue = 0;
+        m_rateLimits.insert(event, limit);
+    } else {
+        m_rateLimits.remove(event);
+    }
+
+    m_rateLimited.storeRelease(m_rateLimits.isEmpty() ? 0 : 1);
+}
+
+bool Ngf::ClientPrivate::allowPlay(const QString &event)
+{
+    // Clients without limits don't pay for the lock
+    if (!m_rateLimited.loadAcquire())
+        return true;
+
+    QMutexLocker locker(&m_rateMutex);
+
+    QHash<QString, RateLimit>::iterator limit = m_rateLimits.find(event);
+    if (limit == m_rateLimits.end())
+        return true;
+
+    const qint64 now = m_clock.elapsed();
+    if (now < limit->nextDue - limit->tolerance) {
+        ++m_suppressedCalls;
+        m_flightRecorder.record(FlightRecorder::Suppress, 0);
+        return false;
+    }
+
+    limit->nextDue = qMax(limit->nextDue, now) + limit->interval;
+    return true;
+}
+
+void Ngf::ClientPrivate::post(Command *command)
+{
+    m_commands->push(command);
+
+    // Only the first command after a drain needs to wake up the client thread
+    if (m_drainScheduled.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "drainCommands", Qt::QueuedConnection);
+}
+
+void Ngf::ClientPrivate::flushCommands()
+{
+    // Calls queued from other threads go first, in case they affect this one
+    if (m_drainScheduled.loadAcquire())
+        drainCommands();
+}
+
+void Ngf::ClientPrivate::drainCommands()
+{
+    // Commands may end up back here through signal handlers
+    if (m_draining)
+        return;
+
+    m_draining = true;
+    m_drainScheduled.fetchAndStoreOrdered(0);
+
+    while (Command *command = m_commands->pop()) {
+        run(command);
+        delete command;
+        ++m_queuedCalls;
+    }
+
+    m_draining = false;
+}
+
+void Ngf::ClientPrivate::run(Command *command)
+{
+    switch (command->type) {
+    case Command::Play:
+        stagePlay(command->clientEventId, command->name, command->properties, command->message,
+                  command->deadline, command->priority, command->issued);
+        break;
+    case Command::PlayOneShot:
+        sendOneShot(command->name, command->properties, command->message);
+        break;
+    case Command::PlayBatch:
+        stageBatch(command->clientEventIds, command->requests, command->issued);
+        break;
+    case Command::ChangeState:
+        applyState(command->clientEventId, command->name, command->state);
+        break;
+    }
+}
+
+bool Ngf::ClientPrivate::sendOneShot(const QString &event, const Proplist &properties,
+                                     const QDBusMessage &play)
+{
+    // Events staged before go out first, so that NGFD gets the calls in the order they were made
+    if (m_dispatchScheduled)
+        dispatch();
+
+    // Short effects are of no use later on, so they aren't held back like events
+    if (m_serviceState == ServiceAbsent) {
+        qCDebug(m_log) << "NGFD not on the bus, dropping one shot" << event;
+        return false;
+    }
+
+    ++m_playsIssued;
+    touchStats();
+    m_flightRecorder.record(FlightRecorder::PlayOneShot, 0);
+
+    if (m_recorder) {
+        TraceRecord record;
+        record.type = TraceRecord::PlayOneShot;
+        record.time = m_clock.nsecsElapsed();
+        record.event = event;
+        record.properties = properties;
+        writeTrace(record);
+    }
+
+    return m_transport->playOneShot(event, properties, play);
+}
+
+void Ngf::ClientPrivate::scheduleDispatch()
+{
+    if (!m_dispatchScheduled) {
+        m_dispatchScheduled = true;
+        QMetaObject::invokeMethod(this, "dispatch", Qt::QueuedConnection);
+    }
+}
+
+void Ngf::ClientPrivate::prepareTransport()
+{
+    if (m_watchWanted && !m_watching) {
+        m_watching = true;
+        m_transport->watch();
+    }
+
+    if (m_statusWanted && !m_statusFollowed) {
+        m_statusFollowed = true;
+        m_transport->setStatusWanted(true);
+    }
+}
+
+void Ngf::ClientPrivate::dispatch()
+{
+    m_dispatchScheduled = false;
+
+    prepareTransport();
+
+    const qint64 now = m_clock.elapsed();
+
+    // Queues are taken from the front one event at a time, signal handlers may play and
+    // stop further events meanwhile
+    for (int priority = 0; priority < PriorityCount; ++priority) {
+        QList<Event*> &queue = m_staged[priority];
+
+        while (!queue.isEmpty()) {
+            Event *event = queue.first();
+
+            // Rest of the background events go out as replies come in
+            if (priority == Client::BackgroundPriority
+                    && event->pendingState != StateStopped
+                    && m_backgroundCalls >= BackgroundCalls)
+                break;
+
+            queue.removeFirst();
+            event->staged = false;
+
+            if (event->pendingState == StateStopped)
+                elide(event);
+            else if (event->deadline && event->deadline <= now)
+                failEvent(event, m_deadlineDropped);
+            else if (m_serviceState == ServiceAbsent)
+                park(event);
+            else
+                sendPlay(event);
+        }
+    }
+}
+
+void Ngf::ClientPrivate::sendPlay(Event *event)
+{
+    // The transport answers with playReply(), where it is finally determined if event is
+    // really running in the NGFD side. Call details are kept until then, in case the
+    // event has to be played again once NGFD is up.
+    event->callPending = true;
+    ++m_pendingCalls;
+    if (event->priority == Client::BackgroundPriority)
+        ++m_backgroundCalls;
+    if (event->deadline)
+        timeCall(event);
+    if (timelinesEnabled())
+        m_timelines->sent(event->clientEventId, m_clock.nsecsElapsed());
+    NGF_TRACE2(dispatch, event->clientEventId, int(event->priority));
+    m_flightRecorder.record(FlightRecorder::Dispatch, event->clientEventId);
+    m_transport->play(event);
+}
+
+static bool deadlineBefore(const Ngf::Event *a, const Ngf::Event *b)
+{
+    return a->deadline < b->deadline;
+}
+
+void Ngf::ClientPrivate::timeCall(Event *event)
+{
+    QList<Event*>::iterator at = std::upper_bound(m_timedCalls.begin(), m_timedCalls.end(),
+                                                  event, deadlineBefore);
+    m_timedCalls.insert(at, event);
+
+    if (m_timedCalls.first() == event)
+        m_deadlineTimer->start(qMax<qint64>(0, event->deadline - m_clock.elapsed()));
+}
+
+void Ngf::ClientPrivate::untimeCall(Event *event)
+{
+    // Timer is left running, expireCalls() copes with nothing being due
+    if (event->deadline)
+        m_timedCalls.removeOne(event);
+}
+
+void Ngf::ClientPrivate::expireCalls()
+{
+    const qint64 now = m_clock.elapsed();
+
+    // Handlers of eventFailed() may remove events, so look them up again one by one
+    QList<quint32> due;
+    foreach (Event *event, m_timedCalls) {
+        if (event->deadline > now)
             break;
+        due.append(event->clientEventId);
+    }
+
+    foreach (quint32 clientEventId, due) {
+        Event *event = m_events.value(clientEventId);
+        if (event && event->callPending) {
+            // Reply is still awaited, and the event stopped if it turns out to have started
+            failEvent(event, m_deadlineDropped);
+        }
+    }
+
+    if (!m_timedCalls.isEmpty())
+        m_deadlineTimer->start(qMax<qint64>(0, m_timedCalls.first()->deadline - now));
+}
+
+void Ngf::ClientPrivate::elide(Event *event)
+{
+    // Stopped before anything was sent, so neither Play nor Stop needs to be made
+    m_elidedCalls += 2;
+    completeUnplayed(event);
+}
+
+void Ngf::ClientPrivate::completeUnplayed(Event *event)
+{
+    quint32 clientEventId = event->clientEventId;
+    quint32 batchId = event->batchId;
+    m_flightRecorder.record(FlightRecorder::Elide, clientEventId);
+    ++m_completions;
+    removeEvent(event);
+    qCDebug(m_log) << clientEventId << "stopped before it played";
+    emit q_ptr->eventCompleted(clientEventId);
+    batchAnswered(batchId);
+}
+
+void Ngf::ClientPrivate::park(Event *event)
+{
+    m_flightRecorder.record(FlightRecorder::Park, event->clientEventId);
+    event->parked = true;
+    event->parkedUntil = m_clock.elapsed() + ParkedTimeout;
+    if (event->deadline && event->deadline < event->parkedUntil)
+        event->parkedUntil = event->deadline;
+    m_parked.append(event);
+    ++m_offlineQueued;
+    qCDebug(m_log) << event->clientEventId << "parked until NGFD is up";
+
+    // Oldest feedback is the least useful one
+    if (m_parked.size() > ParkedLimit)
+        failEvent(m_parked.first(), m_offlineDropped);
+
+    scheduleParkedExpiry();
+}
+
+void Ngf::ClientPrivate::scheduleParkedExpiry()
+{
+    if (m_parked.isEmpty()) {
+        m_parkedTimer->stop();
+        return;
+    }
+
+    // Deadlines make the order differ from the parking order, the queue is short anyway
+    qint64 next = m_parked.first()->parkedUntil;
+    foreach (Event *event, m_parked)
+        next = qMin(next, event->parkedUntil);
+
+    m_parkedTimer->start(qMax<qint64>(0, next - m_clock.elapsed()));
+}
+
+void Ngf::ClientPrivate::unparkAll()
+{
+    if (m_parked.isEmpty())
+        return;
+
+    // All of them go out in one dispatch, in the order they were played
+    qCDebug(m_log) << "NGFD is up, dispatching" << m_parked.size() << "parked events";
+    m_parkedTimer->stop();
+
+    QList<Event*> parked;
+    parked.swap(m_parked);
+
+    foreach (Event *event, parked) {
+        event->parked = false;
+        stage(event);
+    }
+
+    dispatch();
+}
+
+void Ngf::ClientPrivate::expireParked()
+{
+    const qint64 now = m_clock.elapsed();
+
+    // Handlers of eventFailed() may remove events, so look them up again one by one
+    QList<quint32> due;
+    foreach (Event *event, m_parked) {
+        if (event->parkedUntil <= now)
+            due.append(event->clientEventId);
+    }
+
+    foreach (quint32 clientEventId, due) {
+        Event *event = m_events.value(clientEventId);
+        if (event && event->parked) {
+            bool late = event->deadline && event->deadline <= now;
+            failEvent(event, late ? m_deadlineDropped : m_offlineDropped);
+        }
+    }
+
+    scheduleParkedExpiry();
+}
+
+void Ngf::ClientPrivate::failEvent(Event *event, quint64 &dropped)
+{
+    // Event with Play call in flight is answered once the reply arrives
+    quint32 clientEventId = event->clientEventId;
+    quint32 batchId = event->callPending ? 0 : event->batchId;
+    m_flightRecorder.record(FlightRecorder::Fail, clientEventId, 0, &dropped == &m_deadlineDropped);
+    ++dropped;
+    removeEvent(event);
+    qCDebug(m_log) << clientEventId << "dropped";
+    emit q_ptr->eventFailed(clientEventId);
+    batchAnswered(batchId);
+}
+
+void Ngf::ClientPrivate::playReply(Event *event, bool ok, quint32 serverEventId)
+{
+    quint32 batchId = event->batchId;
+    event->callPending = false;
+    --m_pendingCalls;
+    ++m_replies;
+    touchStats();
+    NGF_TRACE3(reply, event->clientEventId, ok, serverEventId);
+    m_flightRecorder.record(FlightRecorder::Reply, event->clientEventId, serverEventId, ok);
+
+    if (m_recorder) {
+        TraceRecord record;
+        record.type = TraceRecord::Reply;
+        record.time = m_clock.nsecsElapsed();
+        record.eventId = event->clientEventId;
+        record.ok = ok;
+        record.serverEventId = serverEventId;
+        writeTrace(record);
+    }
+
+    if (event->priority == Client::BackgroundPriority) {
+        --m_backgroundCalls;
+        if (!m_staged[Client::BackgroundPriority].isEmpty())
+            scheduleDispatch();
+    }
+
+    if (event->orphaned) {
+        // Event was dropped while waiting for the reply, slot can be reused now. Nobody
+        // can stop the event any more if it did start.
+        if (ok)
+            m_transport->stop(serverEventId);
+        m_pool->release(event);
+        batchAnswered(batchId);
+        return;
+    }
+
+    untimeCall(event);
+
+    if (timelinesEnabled())
+        m_timelines->replied(event->clientEventId, serverEventId, m_clock.nsecsElapsed());
+
+    if (!ok && m_serviceState == ServiceAbsent) {
+        // NGFD wasn't there to answer, try again once it is. Play went out already, so
+        // a stopped event doesn't count as elided.
+        if (event->pendingState == StateStopped)
+            completeUnplayed(event);
+        else
+            park(event);
+        return;
+    }
+
+    event->properties.clear();
+    event->message = QDBusMessage();
+
+    if (!ok) {
+        // Starting event failed for some reason, reason can hopefully be determined from
+        // NGFD logs.
+        quint32 clientEventId = event->clientEventId;
+        ++m_replyFailures;
+        removeEvent(event);
+        qCDebug(m_log) << clientEventId << "play: operation failed";
+        emit q_ptr->eventFailed(clientEventId);
+    } else if (event->deadline && m_clock.elapsed() > event->deadline) {
+        // Started too late to be of any use
+        quint32 clientEventId = event->clientEventId;
+        m_transport->stop(serverEventId);
+        ++m_deadlineDropped;
+        removeEvent(event);
+        qCDebug(m_log) << clientEventId << "play: started after deadline";
+        emit q_ptr->eventFailed(clientEventId);
+    } else {
+        event->serverEventId = serverEventId;
+        event->activeState = StatePlaying;
+        m_serverEvents.insert(event->serverEventId, event);
+        qCDebug(m_log) << event->clientEventId << "play: server replied" << event->serverEventId;
+        emit q_ptr->eventPlaying(event->clientEventId);
+
+        if (event->pendingState != StateNew) {
+            qCDebug(m_log) << event->clientEventId
+                           << "wanted state" << event->pendingState
+                           << "differs from active state" << event->activeState;
+            requestEventState(event, event->pendingState);
+            event->pendingState = StateNew;
         }
     }
 
-    watcher->deleteLater();
+    batchAnswered(batchId);
+}
+
+void Ngf::ClientPrivate::batchAnswered(quint32 batchId)
+{
+    if (!batchId)
+        return;
+
+    QHash<quint32, Batch>::iterator batch = m_batches.find(batchId);
+    if (batch == m_batches.end())
+        return;
+
+    if (--batch->unanswered == 0) {
+        QList<quint32> clientEventIds = batch->clientEventIds;
+        m_batches.erase(batch);
+        qCDebug(m_log) << "batch" << batchId << "answered";
+        emit q_ptr->batchFinished(clientEventIds);
+    }
+}
+
+bool Ngf::ClientPrivate::playOneShot(const QString &event, const Proplist &properties)
+{
+    if (!allowPlay(event))
+        return false;
+
+    if (!isOwnerThread()) {
+        post(new Command(Command::PlayOneShot, 0, event, StateNew, properties));
+        return true;
+    }
+
+    flushCommands();
+    return sendOneShot(event, properties, QDBusMessage());
+}
+
+bool Ngf::ClientPrivate::playOneShot(const PreparedEvent &event)
+{
+    if (!event.isValid()) {
+        qCWarning(m_log) << "Can't play invalid prepared event.";
+        return false;
+    }
+
+    if (!allowPlay(event.d->name))
+        return false;
+
+    if (!isOwnerThread()) {
+        post(new Command(Command::PlayOneShot, 0, event.d->name, StateNew,
+                         event.d->properties, event.d->message));
+        return true;
+    }
+
+    flushCommands();
+    return sendOneShot(event.d->name, event.d->properties, event.d->message);
 }
 
 bool Ngf::ClientPrivate::pause(quint32 eventId)
@@ -287,83 +1128,357 @@ bool Ngf::ClientPrivate::stop(const QString &event)
 
 void Ngf::ClientPrivate::removeEvent(Event *event)
 {
-    if (m_events.removeOne(event))
-        delete event;
-    else
+    if (m_events.remove(event->clientEventId)) {
+        if (event->serverEventId)
+            m_serverEvents.remove(event->serverEventId);
+
+        QHash<QString, QList<Event*> >::iterator named = m_namedEvents.find(event->name);
+        if (named != m_namedEvents.end()) {
+            named->removeOne(event);
+            if (named->isEmpty())
+                m_namedEvents.erase(named);
+        }
+
+        if (event->staged)
+            m_staged[event->priority].removeOne(event);
+        if (event->parked)
+            m_parked.removeOne(event);
+        if (event->callPending)
+            untimeCall(event);
+
+        releaseEvent(event);
+        touchStats();
+
+        if (m_events.isEmpty())
+            eventsGone();
+    } else {
         qCWarning(m_log) << "Couldn't find event from event list.";
+    }
 }
 
 void Ngf::ClientPrivate::removeAllEvents()
 {
-    qDeleteAll(m_events);
+    foreach (Event *event, m_events)
+        releaseEvent(event);
+
+    // Batches with events removed before the reply would never finish
+    m_batches.clear();
+    for (int i = 0; i < PriorityCount; ++i)
+        m_staged[i].clear();
+    m_parked.clear();
+    m_parkedTimer->stop();
+    m_timedCalls.clear();
+    m_deadlineTimer->stop();
     m_events.clear();
+    m_serverEvents.clear();
+    m_namedEvents.clear();
+
+    eventsGone();
 }
 
-bool Ngf::ClientPrivate::changeState(quint32 clientEventId, EventState wantedState)
+void Ngf::ClientPrivate::eventsGone()
 {
-    for (int i = 0; i < m_events.size(); ++i) {
-        Event *e = m_events.at(i);
-        if (e->clientEventId == clientEventId) {
-            requestEventState(e, wantedState);
-            break;
+    if (m_statusWanted)
+        m_idleTimer->start();
+}
+
+void Ngf::ClientPrivate::dropStatus()
+{
+    if (m_statusWanted && m_events.isEmpty()) {
+        qCDebug(m_log) << "idle, dropping Status subscription";
+        m_statusWanted = false;
+        if (m_statusFollowed) {
+            m_statusFollowed = false;
+            m_transport->setStatusWanted(false);
         }
     }
+}
+
+void Ngf::ClientPrivate::releaseEvent(Event *event)
+{
+    // Slot of an event with Play call in flight is released once the reply arrives
+    if (event->callPending)
+        event->orphaned = true;
+    else
+        m_pool->release(event);
+}
+
+Ngf::Event *Ngf::ClientPrivate::findEvent(const QString &name) const
+{
+    // Name based requests apply to the oldest event with that name
+    QHash<QString, QList<Event*> >::const_iterator named = m_namedEvents.constFind(name);
+    return named != m_namedEvents.constEnd() ? named->first() : 0;
+}
+
+bool Ngf::ClientPrivate::changeState(quint32 clientEventId, EventState wantedState)
+{
+    if (!isOwnerThread()) {
+        post(new Command(Command::ChangeState, clientEventId, QString(), wantedState));
+        return true;
+    }
+
+    flushCommands();
+    applyState(clientEventId, QString(), wantedState);
 
     return true;
 }
 
 bool Ngf::ClientPrivate::changeState(const QString &clientEventName, EventState wantedState)
 {
-    for (int i = 0; i < m_events.size(); ++i) {
-        Event *e = m_events.at(i);
-        if (e->name == clientEventName) {
-            requestEventState(e, wantedState);
-            break;
-        }
+    if (!isOwnerThread()) {
+        post(new Command(Command::ChangeState, 0, clientEventName, wantedState));
+        return true;
     }
 
+    flushCommands();
+    applyState(0, clientEventName, wantedState);
+
     return true;
 }
 
+void Ngf::ClientPrivate::applyState(quint32 clientEventId, const QString &clientEventName,
+                                    EventState wantedState)
+{
+    if (m_recorder) {
+        TraceRecord record;
+        record.type = wantedState == StatePaused ? TraceRecord::Pause
+                    : wantedState == StatePlaying ? TraceRecord::Resume : TraceRecord::Stop;
+        record.time = m_clock.nsecsElapsed();
+        record.eventId = clientEventId;
+        record.event = clientEventName;
+        writeTrace(record);
+    }
+
+    Event *e = clientEventId ? m_events.value(clientEventId) : findEvent(clientEventName);
+    m_flightRecorder.record(wantedState == StatePaused ? FlightRecorder::Pause
+                            : wantedState == StatePlaying ? FlightRecorder::Resume
+                            : FlightRecorder::Stop,
+                            e ? e->clientEventId : clientEventId);
+    if (e)
+        requestEventState(e, wantedState);
+}
+
 void Ngf::ClientPrivate::requestEventState(Event *event, EventState wantedState)
 {
-    if (event->wantedState == wantedState
-            || event->activeState == StateStopped) {
+    if (event->activeState == StateStopped) {
+        return;
+    } else if (event->parked && wantedState == StateStopped) {
+        // Nothing has reached NGFD, and nothing will. Completed from dispatch() like staged
+        // events, so that no signal is emitted from within the request.
+        m_parked.removeOne(event);
+        event->parked = false;
+        event->pendingState = StateStopped;
+        stage(event);
+        scheduleDispatch();
         return;
     } else if (event->activeState == StateNew) {
-        // can't make further requests before we have an id from play()
-        event->pendingState = wantedState;
+        // can't make further requests before we have an id from play(), or before
+        // play() has even been dispatched
+        event->pendingState = event->wantedState == wantedState ? StateNew : wantedState;
+        return;
+    } else if (event->wantedState == wantedState) {
         return;
     }
 
     event->wantedState = wantedState;
     qCDebug(m_log) << event->clientEventId << "set state" << event->wantedState;
+    NGF_TRACE3(request_state, event->clientEventId, event->serverEventId, int(wantedState));
+    m_flightRecorder.record(FlightRecorder::Request, event->clientEventId, event->serverEventId,
+                            wantedState);
 
     switch (event->wantedState) {
-    case StatePlaying: {
-        QDBusMessage pause = createMethodCall(MethodPause);
-        pause << event->serverEventId << QVariant(false);
-
-        QDBusConnection::systemBus().asyncCall(pause);
+    case StatePlaying:
+        m_transport->pause(event->serverEventId, false);
+        break;
+    case StatePaused:
+        m_transport->pause(event->serverEventId, true);
+        break;
+    case StateStopped:
+        m_transport->stop(event->serverEventId);
+        break;
+    case StateNew:
         break;
     }
-    case StatePaused: {
-        QDBusMessage pause = createMethodCall(MethodPause);
-        pause << event->serverEventId << QVariant(true);
+}
 
-        QDBusConnection::systemBus().asyncCall(pause);
-        break;
+QVariantMap Ngf::ClientPrivate::statistics() const
+{
+    QVariantMap stats;
+
+    if (!isOwnerThread()) {
+        QMetaObject::invokeMethod(const_cast<ClientPrivate*>(this), "statistics",
+                                  Qt::BlockingQueuedConnection, Q_RETURN_ARG(QVariantMap, stats));
+        return stats;
     }
-    case StateStopped: {
-        QDBusMessage stop = createMethodCall(MethodStop);
-        stop << event->serverEventId;
 
-        QDBusConnection::systemBus().asyncCall(stop);
-        break;
+    stats.insert(QStringLiteral("eventSlots"), m_pool->capacity());
+    stats.insert(QStringLiteral("eventSlotsInUse"), m_pool->used());
+    stats.insert(QStringLiteral("elidedCalls"), m_elidedCalls);
+    stats.insert(QStringLiteral("offlineQueued"), m_offlineQueued);
+    stats.insert(QStringLiteral("offlineDropped"), m_offlineDropped);
+    stats.insert(QStringLiteral("deadlineDropped"), m_deadlineDropped);
+    stats.insert(QStringLiteral("queuedCalls"), m_queuedCalls);
+    m_rateMutex.lock();
+    stats.insert(QStringLiteral("suppressedCalls"), m_suppressedCalls);
+    m_rateMutex.unlock();
+    stats.insert(QStringLiteral("stagedRealtime"), m_staged[Client::RealtimePriority].size());
+    stats.insert(QStringLiteral("stagedNormal"), m_staged[Client::NormalPriority].size());
+    stats.insert(QStringLiteral("stagedBackground"), m_staged[Client::BackgroundPriority].size());
+    stats.insert(QStringLiteral("stagedPeakRealtime"), m_stagedPeak[Client::RealtimePriority]);
+    stats.insert(QStringLiteral("stagedPeakNormal"), m_stagedPeak[Client::NormalPriority]);
+    stats.insert(QStringLiteral("stagedPeakBackground"), m_stagedPeak[Client::BackgroundPriority]);
+    stats.insert(QStringLiteral("backgroundCalls"), m_backgroundCalls);
+    stats.insert(QStringLiteral("playsIssued"), m_playsIssued);
+    stats.insert(QStringLiteral("replies"), m_replies);
+    QVariantMap failures;
+    failures.insert(QStringLiteral("reply"), m_replyFailures);
+    failures.insert(QStringLiteral("status"), m_statusFailures);
+    failures.insert(QStringLiteral("offline"), m_offlineDropped);
+    failures.insert(QStringLiteral("deadline"), m_deadlineDropped);
+    stats.insert(QStringLiteral("failures"), failures);
+    stats.insert(QStringLiteral("completions"), m_completions);
+    stats.insert(QStringLiteral("eventsInFlight"), m_events.size());
+    stats.insert(QStringLiteral("eventsInFlightPeak"), m_eventsPeak);
+    stats.insert(QStringLiteral("pendingCalls"), m_pendingCalls);
+    stats.insert(QStringLiteral("bytesMarshalled"), m_transport->bytesMarshalled());
+    stats.insert(QStringLiteral("statusReceived"), m_statusReceived);
+    stats.insert(QStringLiteral("statusMatched"), m_statusMatched);
+    stats.insert(QStringLiteral("statusSubscribed"), m_statusFollowed);
+
+    return stats;
+}
+
+void Ngf::ClientPrivate::setTimelinesEnabled(bool enabled)
+{
+    // Events played from here on are recorded, already recorded ones are kept
+    m_timelinesEnabled.storeRelease(enabled ? 1 : 0);
+}
+
+bool Ngf::ClientPrivate::timelinesEnabled() const
+{
+    return m_timelinesEnabled.loadAcquire();
+}
+
+QVariantMap Ngf::ClientPrivate::timeline(quint32 eventId) const
+{
+    QVariantMap result;
+
+    if (!isOwnerThread()) {
+        QMetaObject::invokeMethod(const_cast<ClientPrivate*>(this), "timeline",
+                                  Qt::BlockingQueuedConnection, Q_RETURN_ARG(QVariantMap, result),
+                                  Q_ARG(quint32, eventId));
+        return result;
     }
-    case StateNew:
-        break;
+
+    return m_timelines->timeline(eventId);
+}
+
+QVariantMap Ngf::ClientPrivate::latencies() const
+{
+    QVariantMap result;
+
+    if (!isOwnerThread()) {
+        QMetaObject::invokeMethod(const_cast<ClientPrivate*>(this), "latencies",
+                                  Qt::BlockingQueuedConnection, Q_RETURN_ARG(QVariantMap, result));
+        return result;
+    }
+
+    return m_timelines->latencies();
+}
+
+bool Ngf::ClientPrivate::startRecording(const QString &fileName)
+{
+    if (!isOwnerThread()) {
+        bool started = false;
+        QMetaObject::invokeMethod(this, "startRecording", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, started), Q_ARG(QString, fileName));
+        return started;
+    }
+
+    // Calls queued from other threads before this one belong to the previous trace
+    flushCommands();
+    stopRecording();
+
+    TraceWriter *recorder = new TraceWriter;
+    if (!recorder->open(fileName)) {
+        qCWarning(m_log) << "Can't record to" << fileName;
+        delete recorder;
+        return false;
+    }
+
+    m_recorder = recorder;
+    return true;
+}
+
+bool Ngf::ClientPrivate::stopRecording()
+{
+    if (!isOwnerThread()) {
+        bool complete = false;
+        QMetaObject::invokeMethod(this, "stopRecording", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, complete));
+        return complete;
+    }
+
+    flushCommands();
+
+    bool complete = !m_recordingFailed;
+    if (m_recorder && !m_recorder->close()) {
+        qCWarning(m_log) << "Trace couldn't be written out, it is incomplete";
+        complete = false;
+    }
+
+    delete m_recorder;
+    m_recorder = 0;
+    m_recordingFailed = false;
+    return complete;
+}
+
+void Ngf::ClientPrivate::writeTrace(const TraceRecord &record)
+{
+    if (!m_recorder->write(record)) {
+        // Rest of the trace would be missing records anyway
+        qCWarning(m_log) << "Writing trace failed, recording stopped";
+        m_recorder->close();
+        delete m_recorder;
+        m_recorder = 0;
+        m_recordingFailed = true;
+    }
+}
+
+QString Ngf::ClientPrivate::dumpFlightRecorder() const
+{
+    // Ring is safe to read from any thread
+    return m_flightRecorder.dump();
+}
+
+Ngf::ClientStats *Ngf::ClientPrivate::stats()
+{
+    // Lives in the thread of the client object, also when this one runs in a dispatcher.
+    // Only that thread creates it, the dispatcher just reads the pointer in touchStats().
+    Q_ASSERT_X(QThread::currentThread() == q_ptr->thread(), "Ngf::Client::stats",
+               "must be called from the thread of the client object");
+
+    ClientStats *stats = m_stats.loadAcquire();
+    if (!stats) {
+        stats = new ClientStats(q_ptr);
+        stats->refresh();
+        m_stats.storeRelease(stats);
     }
+
+    return stats;
+}
+
+void Ngf::ClientPrivate::touchStats()
+{
+    // Updates are batched, nobody needs to see every single change
+    if (m_stats.loadAcquire() && !m_statsTimer->isActive())
+        m_statsTimer->start();
+}
+
+void Ngf::ClientPrivate::publishStats()
+{
+    QMetaObject::invokeMethod(m_stats.loadAcquire(), "update", Qt::AutoConnection,
+                              Q_ARG(QVariantMap, statistics()));
 }
 
 void Ngf::ClientPrivate::changeConnected(bool connected)
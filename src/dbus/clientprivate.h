@@ -22,16 +22,31 @@
 #define NGFCLIENTDBUSPRIVATE_H
 
 #include <QObject>
+#include <QAtomicInt>
+#include <QAtomicPointer>
 #include <QDBusConnection>
-#include <QDBusPendingCallWatcher>
-#include <QDBusServiceWatcher>
+#include <QDBusMessage>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QList>
 #include <QLoggingCategory>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
 #include "ngfclient.h"
+#include "flightrecorder.h"
 
 namespace Ngf
 {
+    class Command;
+    class CommandQueue;
     class Event;
+    class EventPool;
+    class ClientStats;
+    class Timelines;
+    class TraceRecord;
+    class TraceWriter;
+    class Transport;
 
     typedef QMap<QString, QVariant> Proplist;
 
@@ -43,17 +58,40 @@ namespace Ngf
         ClientPrivate(Client *parent);
         virtual ~ClientPrivate();
 
-        bool connect();
-        bool isConnected();
-        void disconnect();
+        bool openPrivateConnection(const QDBusConnection &connection);
+        bool openPeerConnection(const QString &address);
+        bool openLoopback(int replyDelay, int statusDelay, int duration);
+        bool startDispatcherThread();
+        void stopDispatcherThread();
+        Q_INVOKABLE bool connect();
+        void warmUp(bool ping);
+        Q_INVOKABLE bool isConnected();
+        Q_INVOKABLE void disconnect();
         quint32 play(const QString &event);
         quint32 play(const QString &event, const Proplist &properties);
+        quint32 play(const QString &event, const Proplist &properties, int deadline);
+        quint32 play(const QString &event, const Proplist &properties, Client::Priority priority,
+                     int deadline);
+        bool playOneShot(const QString &event, const Proplist &properties);
+        QList<quint32> playBatch(const QList<EventRequest> &requests);
+        PreparedEvent prepare(const QString &event, const Proplist &properties);
+        quint32 play(const PreparedEvent &event);
+        bool playOneShot(const PreparedEvent &event);
         bool pause(quint32 eventId);
         bool pause(const QString &event);
         bool resume(quint32 eventId);
         bool resume(const QString &event);
         bool stop(quint32 eventId);
         bool stop(const QString &event);
+        void setRateLimit(const QString &event, int interval, int burst);
+        Q_INVOKABLE QVariantMap statistics() const;
+        void setTimelinesEnabled(bool enabled);
+        Q_INVOKABLE QVariantMap timeline(quint32 eventId) const;
+        Q_INVOKABLE QVariantMap latencies() const;
+        ClientStats *stats();
+        Q_INVOKABLE bool startRecording(const QString &fileName);
+        Q_INVOKABLE bool stopRecording();
+        QString dumpFlightRecorder() const;
 
         enum EventState {
             StateNew,
@@ -63,26 +101,173 @@ namespace Ngf
         };
 
     private slots:
-        void playPendingReply(QDBusPendingCallWatcher *watcher);
         void setEventState(quint32 serverEventId, quint32 state);
-        void serviceUnregistered(const QString &service);
+        void serviceLost();
+        void dispatch();
+        void drainCommands();
+        void returnToClientThread();
+        void dropStatus();
+        void startWarmUp(bool ping);
+        void serviceAvailable(bool available);
+        void servicePresent(bool present);
+        void expireParked();
+        void expireCalls();
+        void publishStats();
 
     private:
+        friend class Transport;
+
+        enum { IdleStatusTimeout = 1000 }; // [ms]
+        // Plays made while NGFD is away are held back this long, and this many at most
+        enum { ParkedLimit = 32 };
+        enum { ParkedTimeout = 3000 }; // [ms]
+        // Background events with Play calls in flight at most
+        enum { BackgroundCalls = 4 };
+        enum { PriorityCount = Client::BackgroundPriority + 1 };
+        enum { StatsInterval = 250 }; // [ms] Between updates of ClientStats
+
+        enum ServiceState {
+            ServiceUnknown,
+            ServicePresent,
+            ServiceAbsent
+        };
+
+        void setTransport(Transport *transport);
+        bool checkUnused(const char *warning);
+        bool isOwnerThread() const;
+        quint32 nextClientEventId();
+        bool allowPlay(const QString &event);
+        void post(Command *command);
+        void flushCommands();
+        void run(Command *command);
+        bool sendOneShot(const QString &event, const Proplist &properties,
+                         const QDBusMessage &play);
+        void applyState(quint32 clientEventId, const QString &clientEventName,
+                        EventState wantedState);
+        void writeTrace(const TraceRecord &record);
+        qint64 deadlineAt(qint64 issued, int deadline) const;
+        quint32 requestPlay(const QString &event, const Proplist &properties, const QDBusMessage &play,
+                            int deadline, Client::Priority priority);
+        void stagePlay(quint32 clientEventId, const QString &event, const Proplist &properties,
+                       const QDBusMessage &play, qint64 deadline, Client::Priority priority,
+                       qint64 issued);
+        bool timelinesEnabled() const;
+        void stage(Event *event);
+        void stageBatch(const QList<quint32> &clientEventIds, const QList<EventRequest> &requests,
+                        qint64 issued);
+        void scheduleDispatch();
+        void sendPlay(Event *event);
+        void elide(Event *event);
+        void completeUnplayed(Event *event);
+        void park(Event *event);
+        void unparkAll();
+        void scheduleParkedExpiry();
+        void failEvent(Event *event, quint64 &dropped);
+        void timeCall(Event *event);
+        void untimeCall(Event *event);
+        void playReply(Event *event, bool ok, quint32 serverEventId);
+        void batchAnswered(quint32 batchId);
         void requestEventState(Event *event, EventState wantedState);
         void removeEvent(Event *event);
         void removeAllEvents();
+        void releaseEvent(Event *event);
+        Event *findEvent(const QString &name) const;
         bool changeState(quint32 clientEventId, EventState wantedState);
         bool changeState(const QString &clientEventName, EventState wantedState);
         void changeConnected(bool connected);
+        void eventsGone();
+        void touchStats();
+        void prepareTransport();
 
         Client * const q_ptr;
         Q_DECLARE_PUBLIC(Client)
 
         QLoggingCategory m_log;
-        QDBusServiceWatcher *m_serviceWatcher;
+        Transport *m_transport;
+        bool m_watchWanted;     // connect() has been called
+        bool m_watching;        // Transport has been told to follow NGFD
         bool m_connected;
-        quint32 m_clientEventId; // Internal counter for client event ids, incremented every time play is called.
-        QList<Event*> m_events;
+        bool m_warmUpPending;   // warmUp() hasn't found NGFD yet
+        bool m_warmUpPing;
+        QAtomicInteger<quint32> m_clientEventId; // Internal counter for client event ids, incremented every time play is called.
+        // Calls from other threads are queued here and carried out in the thread of the client
+        CommandQueue *m_commands;
+        QAtomicInt m_drainScheduled;
+        bool m_draining;
+        quint64 m_queuedCalls;
+        // Thread the client was created in, and the one the client runs in when it has a
+        // dispatcher thread of its own
+        QThread *m_clientThread;
+        QThread *m_dispatcher;
+        EventPool *m_pool;
+        // Every live event is indexed by its client id, and by its server id once the
+        // Play reply has arrived. Events sharing a name are kept in play order.
+        QHash<quint32, Event*> m_events;
+        QHash<quint32, Event*> m_serverEvents;
+        QHash<QString, QList<Event*> > m_namedEvents;
+        // Play requests wait here until the end of the current event loop iteration, so
+        // that events stopped right after play() never reach NGFD. Each priority class
+        // has a queue of its own, realtime events are sent first and background events
+        // only a few at a time.
+        QList<Event*> m_staged[PriorityCount];
+        int m_stagedPeak[PriorityCount];
+        int m_backgroundCalls;
+        bool m_dispatchScheduled;
+        quint64 m_elidedCalls;
+        // Plays made while NGFD isn't on the bus wait here, oldest first, until it
+        // registers again. Nothing is sent for them in the meantime.
+        ServiceState m_serviceState;
+        QList<Event*> m_parked;
+        QTimer *m_parkedTimer;
+        QElapsedTimer m_clock;
+        quint64 m_offlineQueued;
+        quint64 m_offlineDropped;
+        // Play calls of events with a deadline, soonest deadline first
+        QList<Event*> m_timedCalls;
+        QTimer *m_deadlineTimer;
+        quint64 m_deadlineDropped;
+        // Status is followed only while there are events, and dropped once the client
+        // has been idle for a while
+        bool m_statusWanted;
+        bool m_statusFollowed;  // Transport has been told to follow Status
+        QTimer *m_idleTimer;
+        quint64 m_statusReceived;
+        quint64 m_statusMatched;
+        // Counters for monitoring, published to ClientStats once someone has asked for it
+        quint64 m_playsIssued;
+        quint64 m_replies;
+        quint64 m_replyFailures;
+        quint64 m_statusFailures;
+        quint64 m_completions;
+        int m_pendingCalls;
+        int m_eventsPeak;
+        QAtomicPointer<ClientStats> m_stats;
+        QTimer *m_statsTimer;
+        // Rate limits are applied in the calling thread, before anything is queued. Each
+        // limit is a token bucket kept as the time the next play is due, which may be
+        // up to burst - 1 intervals ahead of now while tokens remain.
+        struct RateLimit {
+            qint64 interval;    // [ms]
+            qint64 tolerance;   // [ms]
+            qint64 nextDue;
+        };
+        mutable QMutex m_rateMutex;
+        QHash<QString, RateLimit> m_rateLimits;
+        QAtomicInt m_rateLimited;   // Set while there are any limits
+        quint64 m_suppressedCalls;
+        // Timestamps of events and their latencies, recorded only when asked for
+        QAtomicInt m_timelinesEnabled;
+        Timelines *m_timelines;
+        // Calls and replies are written here while recording, only touched in the client thread
+        TraceWriter *m_recorder;
+        bool m_recordingFailed;
+        FlightRecorder m_flightRecorder;
+        struct Batch {
+            QList<quint32> clientEventIds;
+            int unanswered;
+        };
+        quint32 m_batchId;
+        QHash<quint32, Batch> m_batches;
     };
 }
 
@@ -0,0 +1,104 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "ngfclient.h"
+#include "ngfclientstats.h"
+
+Ngf::ClientStats::ClientStats(QObject *client)
+    : QObject(client)
+{
+}
+
+Ngf::ClientStats::~ClientStats()
+{
+}
+
+qulonglong Ngf::ClientStats::playsIssued() const
+{
+    return m_values.value(QStringLiteral("playsIssued")).toULongLong();
+}
+
+qulonglong Ngf::ClientStats::replies() const
+{
+    return m_values.value(QStringLiteral("replies")).toULongLong();
+}
+
+qulonglong Ngf::ClientStats::failures() const
+{
+    qulonglong failures = 0;
+
+    const QVariantMap reasons = failuresByReason();
+    for (QVariantMap::const_iterator i = reasons.constBegin(); i != reasons.constEnd(); ++i)
+        failures += i.value().toULongLong();
+
+    return failures;
+}
+
+QVariantMap Ngf::ClientStats::failuresByReason() const
+{
+    return m_values.value(QStringLiteral("failures")).toMap();
+}
+
+qulonglong Ngf::ClientStats::completions() const
+{
+    return m_values.value(QStringLiteral("completions")).toULongLong();
+}
+
+int Ngf::ClientStats::eventsInFlight() const
+{
+    return m_values.value(QStringLiteral("eventsInFlight")).toInt();
+}
+
+int Ngf::ClientStats::eventsInFlightPeak() const
+{
+    return m_values.value(QStringLiteral("eventsInFlightPeak")).toInt();
+}
+
+int Ngf::ClientStats::pendingCalls() const
+{
+    return m_values.value(QStringLiteral("pendingCalls")).toInt();
+}
+
+qulonglong Ngf::ClientStats::statusReceived() const
+{
+    return m_values.value(QStringLiteral("statusReceived")).toULongLong();
+}
+
+qulonglong Ngf::ClientStats::statusMatched() const
+{
+    return m_values.value(QStringLiteral("statusMatched")).toULongLong();
+}
+
+qulonglong Ngf::ClientStats::bytesMarshalled() const
+{
+    return m_values.value(QStringLiteral("bytesMarshalled")).toULongLong();
+}
+
+void Ngf::ClientStats::refresh()
+{
+    // Parent is always the client, see Client::stats()
+    update(static_cast<Client*>(parent())->statistics());
+}
+
+void Ngf::ClientStats::update(const QVariantMap &statistics)
+{
+    m_values = statistics;
+    emit changed();
+}
@@ -0,0 +1,74 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "commandqueue.h"
+
+Ngf::CommandQueue::CommandQueue()
+    : m_head(&m_stub),
+      m_tail(&m_stub),
+      m_stub(Command::Play, 0, QString())
+{
+}
+
+Ngf::CommandQueue::~CommandQueue()
+{
+    while (Command *command = pop())
+        delete command;
+}
+
+void Ngf::CommandQueue::push(Command *command)
+{
+    command->next.storeRelease(0);
+    Command *previous = m_head.fetchAndStoreAcquireRelease(command);
+    // Between the exchange and this store the queue is momentarily cut in two
+    previous->next.storeRelease(command);
+}
+
+Ngf::Command *Ngf::CommandQueue::pop()
+{
+    Command *tail = m_tail;
+    Command *next = tail->next.loadAcquire();
+
+    if (tail == &m_stub) {
+        if (!next)
+            return 0;
+        m_tail = next;
+        tail = next;
+        next = next->next.loadAcquire();
+    }
+
+    if (next) {
+        m_tail = next;
+        return tail;
+    }
+
+    if (tail != m_head.loadAcquire())
+        return 0;
+
+    // Last command in the queue, put the stub behind it so that it can be taken out
+    push(&m_stub);
+    next = tail->next.loadAcquire();
+    if (next) {
+        m_tail = next;
+        return tail;
+    }
+
+    return 0;
+}
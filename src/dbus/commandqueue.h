@@ -0,0 +1,100 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTCOMMANDQUEUE_H
+#define NGFCLIENTCOMMANDQUEUE_H
+
+#include <QAtomicPointer>
+#include <QDBusMessage>
+#include <QString>
+#include "clientprivate.h"
+
+namespace Ngf
+{
+    // Request made from a thread other than the one owning the client
+    class Command
+    {
+    public:
+        enum Type {
+            Play,
+            PlayOneShot,
+            PlayBatch,
+            ChangeState
+        };
+
+        Command(Type _type, quint32 _clientEventId, const QString &_name,
+                ClientPrivate::EventState _state = ClientPrivate::StateNew,
+                const Proplist &_properties = Proplist(),
+                const QDBusMessage &_message = QDBusMessage(),
+                qint64 _deadline = 0, Client::Priority _priority = Client::NormalPriority,
+                qint64 _issued = 0)
+            : type(_type), clientEventId(_clientEventId), name(_name), state(_state),
+              properties(_properties), message(_message), deadline(_deadline), issued(_issued),
+              priority(_priority)
+        {}
+
+        Command(const QList<quint32> &_clientEventIds, const QList<EventRequest> &_requests,
+                qint64 _issued)
+            : type(PlayBatch), clientEventId(0), state(ClientPrivate::StateNew),
+              deadline(0), issued(_issued), priority(Client::NormalPriority),
+              clientEventIds(_clientEventIds), requests(_requests)
+        {}
+
+        QAtomicPointer<Command> next;
+        const Type type;
+        const quint32 clientEventId;    // Zero when the event is referred to by name
+        const QString name;
+        const ClientPrivate::EventState state;
+        const Proplist properties;
+        const QDBusMessage message;     // Prepared Play call, if any
+        const qint64 deadline;          // Client clock time the event must start by, 0 if none
+        const qint64 issued;            // Client clock nanoseconds of the play call
+        const Client::Priority priority;
+        const QList<quint32> clientEventIds;
+        const QList<EventRequest> requests;
+
+    private:
+        Q_DISABLE_COPY(Command)
+    };
+
+    // Intrusive multiple producer, single consumer queue. Pushing is wait free and
+    // takes one atomic exchange, so callers never block on the owning thread.
+    class CommandQueue
+    {
+    public:
+        CommandQueue();
+        ~CommandQueue();
+
+        // Any thread
+        void push(Command *command);
+        // Owning thread only. May return 0 while a push is half way through, the
+        // pushing thread makes sure the queue gets drained again after that.
+        Command *pop();
+
+    private:
+        QAtomicPointer<Command> m_head;     // Most recently pushed
+        Command *m_tail;                    // Next to pop
+        Command m_stub;
+
+        Q_DISABLE_COPY(CommandQueue)
+    };
+}
+
+#endif
@@ -3,9 +3,33 @@ INCLUDEPATH += ./dbus
 HEADERS += \
     include/ngfclient.h \
     include/ngfclient_global.h \
-    dbus/clientprivate.h
+    include/ngfclientstats.h \
+    include/ngfeventrequest.h \
+    include/ngfpreparedevent.h \
+    include/ngftrace.h \
+    dbus/clientprivate.h \
+    dbus/commandqueue.h \
+    dbus/dbustransport.h \
+    dbus/eventpool.h \
+    dbus/flightrecorder.h \
+    dbus/loopbacktransport.h \
+    dbus/preparedeventprivate.h \
+    dbus/timeline.h \
+    dbus/tracepoints.h \
+    dbus/tracewriter.h \
+    dbus/transport.h
 
 SOURCES += \
     dbus/client.cpp \
-    dbus/clientprivate.cpp
+    dbus/clientprivate.cpp \
+    dbus/clientstats.cpp \
+    dbus/commandqueue.cpp \
+    dbus/dbustransport.cpp \
+    dbus/eventpool.cpp \
+    dbus/flightrecorder.cpp \
+    dbus/loopbacktransport.cpp \
+    dbus/preparedevent.cpp \
+    dbus/timeline.cpp \
+    dbus/trace.cpp \
+    dbus/transport.cpp
 
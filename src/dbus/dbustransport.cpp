@@ -0,0 +1,533 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QFile>
+#include <QtDBus>
+#include "dbustransport.h"
+#include "eventpool.h"
+
+namespace Ngf
+{
+    const static QString NgfDestination     = "com.nokia.NonGraphicFeedback1.Backend";
+    const static QString NgfPath            = "/com/nokia/NonGraphicFeedback1";
+    const static QString NgfInterface       = "com.nokia.NonGraphicFeedback1";
+    const static QString MethodPlay         = "Play";
+    const static QString MethodStop         = "Stop";
+    const static QString MethodPause        = "Pause";
+    const static QString SignalStatus       = "Status";
+    const static QString DBusService        = "org.freedesktop.DBus";
+    const static QString DBusPath           = "/org/freedesktop/DBus";
+    const static QString DBusInterface      = "org.freedesktop.DBus";
+    const static QString PeerInterface      = "org.freedesktop.DBus.Peer";
+}
+
+QDBusMessage createMethodCall(const QString &method)
+{
+    return QDBusMessage::createMethodCall(Ngf::NgfDestination, Ngf::NgfPath, Ngf::NgfInterface, method);
+}
+
+// Rough wire size of a message, padding aside. Strings are counted in UTF-16 code
+// units, event names and property keys are ASCII in practice.
+static int stringSize(const QString &string)
+{
+    return 4 + string.size() + 1;
+}
+
+static int variantSize(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::QString:
+        return stringSize(value.toString());
+    case QMetaType::Bool:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+        return 4;
+    case QMetaType::QVariantMap: {
+        // Dictionary entries are 8 aligned, values are variants with a signature
+        const QVariantMap map = value.toMap();
+        int size = 4;
+        for (QVariantMap::const_iterator i = map.constBegin(); i != map.constEnd(); ++i)
+            size += 8 + stringSize(i.key()) + 3 + variantSize(i.value());
+        return size;
+    }
+    default:
+        return 8;
+    }
+}
+
+static int marshalledSize(const QDBusMessage &message)
+{
+    // Fixed header, header fields and arguments
+    int size = 16 + 4 * 8 + stringSize(message.service()) + stringSize(message.path())
+            + stringSize(message.interface()) + stringSize(message.member());
+
+    foreach (const QVariant &argument, message.arguments())
+        size += variantSize(argument);
+
+    return size;
+}
+
+Ngf::ReplyTracker::ReplyTracker(DBusTransport *transport, Event *event)
+    : QObject(transport),
+      m_transport(transport),
+      m_event(event)
+{
+}
+
+Ngf::ReplyTracker::~ReplyTracker()
+{
+    // Transport may go first, the slot then gets a new tracker if it is used again
+    m_event->tracker = 0;
+}
+
+void Ngf::ReplyTracker::reply(const QDBusMessage &message)
+{
+    m_transport->reply(m_event, message);
+}
+
+void Ngf::ReplyTracker::error(const QDBusError &error, const QDBusMessage &message)
+{
+    Q_UNUSED(error);
+
+    m_transport->reply(m_event, message);
+}
+
+void Ngf::ReplyTracker::cancel()
+{
+    m_transport->reply(m_event, QDBusMessage());
+}
+
+Ngf::ClientDebug::ClientDebug(ClientPrivate *client)
+    : QObject(0),
+      m_client(client)
+{
+}
+
+QString Ngf::ClientDebug::DumpFlightRecorder() const
+{
+    return m_client->dumpFlightRecorder();
+}
+
+Ngf::DBusTransport::DBusTransport(ClientPrivate *client)
+    : Transport(client),
+      m_bus(QString()),
+      m_connection(m_bus),
+      m_busOpen(false),
+      m_statusWanted(false),
+      m_statusSubscribed(false),
+      m_serviceWatcher(0),
+      m_pingWanted(false),
+      m_debug(0)
+{
+}
+
+Ngf::DBusTransport::~DBusTransport()
+{
+    closePeerConnection();
+    closePrivateConnection();
+    unexportDebug();
+}
+
+bool Ngf::DBusTransport::openPrivateConnection(const QDBusConnection &connection)
+{
+    if (!connection.isConnected()) {
+        qCWarning(m_log) << "Couldn't open private connection" << connection.name()
+                         << connection.lastError().message();
+        QDBusConnection::disconnectFromBus(connection.name());
+        return false;
+    }
+
+    closePrivateConnection();
+    unexportDebug();
+
+    m_bus = connection;
+    m_busOpen = true;
+    if (m_peerConnection.isEmpty())
+        m_connection = m_bus;
+    exportDebug();
+    m_privateConnection = connection.name();
+    qCDebug(m_log) << "using private connection" << m_privateConnection;
+
+    return true;
+}
+
+void Ngf::DBusTransport::closePrivateConnection()
+{
+    if (m_privateConnection.isEmpty())
+        return;
+
+    delete m_serviceWatcher;
+    m_serviceWatcher = 0;
+    if (m_peerConnection.isEmpty())
+        unsubscribeStatus();
+    unexportDebug();
+
+    m_bus = QDBusConnection(QString());
+    m_busOpen = false;
+    if (m_peerConnection.isEmpty())
+        m_connection = m_bus;
+    QDBusConnection::disconnectFromBus(m_privateConnection);
+    m_privateConnection.clear();
+}
+
+bool Ngf::DBusTransport::openPeerConnection(const QString &address)
+{
+    QString peerAddress = address;
+    if (peerAddress.isEmpty())
+        peerAddress = QString::fromLocal8Bit(qgetenv("NGF_PEER_ADDRESS"));
+    if (peerAddress.isEmpty() && qEnvironmentVariableIsSet("XDG_RUNTIME_DIR"))
+        peerAddress = QStringLiteral("unix:path=%1/ngfd/peer")
+                .arg(QString::fromLocal8Bit(qgetenv("XDG_RUNTIME_DIR")));
+
+    // Don't bother trying if NGFD hasn't created the socket
+    if (peerAddress.isEmpty() || (peerAddress.startsWith(QLatin1String("unix:path="))
+            && !QFile::exists(peerAddress.mid(10).section(QLatin1Char(','), 0, 0)))) {
+        qCDebug(m_log) << "no peer socket at" << peerAddress << "using message bus";
+        return false;
+    }
+
+    closePeerConnection();
+
+    const QString name = QStringLiteral("ngf-qt-peer-%1").arg(reinterpret_cast<quintptr>(this), 0, 16);
+    QDBusConnection peer = QDBusConnection::connectToPeer(peerAddress, name);
+    if (!peer.isConnected()) {
+        qCWarning(m_log) << "Couldn't connect to peer" << peerAddress << peer.lastError().message()
+                         << "using message bus";
+        QDBusConnection::disconnectFromPeer(name);
+        return false;
+    }
+
+    m_connection = peer;
+    m_peerConnection = name;
+    qCDebug(m_log) << "using peer connection to" << peerAddress;
+
+    return true;
+}
+
+void Ngf::DBusTransport::closePeerConnection()
+{
+    if (m_peerConnection.isEmpty())
+        return;
+
+    unsubscribeStatus();
+
+    m_connection = m_bus;
+    QDBusConnection::disconnectFromPeer(m_peerConnection);
+    m_peerConnection.clear();
+
+    // Carry on over the message bus
+    subscribeStatus();
+}
+
+void Ngf::DBusTransport::peerDisconnected()
+{
+    if (m_peerConnection.isEmpty())
+        return;
+
+    qCWarning(m_log) << "Peer connection to NGFD lost, falling back to message bus";
+
+    closePeerConnection();
+    emit serviceLost();
+}
+
+void Ngf::DBusTransport::openBus()
+{
+    // System bus connection is opened only once there is something to send
+    if (!m_busOpen) {
+        m_busOpen = true;
+        m_bus = QDBusConnection::systemBus();
+        if (m_peerConnection.isEmpty())
+            m_connection = m_bus;
+        exportDebug();
+    }
+}
+
+void Ngf::DBusTransport::exportDebug()
+{
+    static const bool wanted = qEnvironmentVariableIsSet("NGF_CLIENT_DEBUG_DBUS");
+    if (!wanted || m_debug)
+        return;
+
+    // Every client of the process has a path of its own
+    m_debug = new ClientDebug(m_client);
+    const QString path = QStringLiteral("/org/sailfishos/ngf/client_%1")
+            .arg(reinterpret_cast<quintptr>(m_client), 0, 16);
+    if (m_bus.registerObject(path, m_debug, QDBusConnection::ExportScriptableSlots)) {
+        qCDebug(m_log) << "debug interface at" << path << "on" << m_bus.baseService();
+    } else {
+        qCWarning(m_log) << "Couldn't export debug interface at" << path;
+        unexportDebug();
+    }
+}
+
+void Ngf::DBusTransport::unexportDebug()
+{
+    if (!m_debug)
+        return;
+
+    // Unregistered along with the object
+    delete m_debug;
+    m_debug = 0;
+}
+
+void Ngf::DBusTransport::subscribeStatus()
+{
+    if (!m_statusSubscribed && m_statusWanted && m_serviceWatcher) {
+        openBus();
+
+        // On the bus only Status from the owner of NGFD name is of interest, a peer
+        // connection has NGFD alone at the other end
+        m_statusSender = m_peerConnection.isEmpty() ? NgfDestination : QString();
+        m_statusSubscribed = m_connection.connect(m_statusSender, NgfPath, NgfInterface, SignalStatus,
+                                                  this, SLOT(statusReceived(quint32,quint32)));
+    }
+}
+
+void Ngf::DBusTransport::unsubscribeStatus()
+{
+    if (m_statusSubscribed) {
+        m_connection.disconnect(m_statusSender, NgfPath, NgfInterface, SignalStatus,
+                                this, SLOT(statusReceived(quint32,quint32)));
+        m_statusSubscribed = false;
+    }
+}
+
+void Ngf::DBusTransport::setStatusWanted(bool wanted)
+{
+    m_statusWanted = wanted;
+
+    if (m_statusWanted)
+        subscribeStatus();
+    else
+        unsubscribeStatus();
+}
+
+void Ngf::DBusTransport::statusReceived(quint32 serverEventId, quint32 state)
+{
+    emit status(serverEventId, state);
+}
+
+void Ngf::DBusTransport::watch()
+{
+    if (!m_serviceWatcher) {
+        openBus();
+        m_serviceWatcher = new QDBusServiceWatcher(NgfDestination,
+                                                   m_bus,
+                                                   QDBusServiceWatcher::WatchForOwnerChange,
+                                                   this);
+
+        QObject::connect(m_serviceWatcher, SIGNAL(serviceOwnerChanged(QString,QString,QString)),
+                         this, SLOT(serviceOwnerChanged(QString,QString,QString)));
+
+        subscribeStatus();
+
+        // Plays made at boot, before NGFD is up, shouldn't be sent just to time out
+        if (m_peerConnection.isEmpty()) {
+            QDBusMessage nameHasOwner = QDBusMessage::createMethodCall(DBusService, DBusPath,
+                                                                       DBusInterface,
+                                                                       QStringLiteral("NameHasOwner"));
+            nameHasOwner << NgfDestination;
+            m_bus.callWithCallback(nameHasOwner, this, SLOT(presenceReply(QDBusMessage)),
+                                   SLOT(presenceError(QDBusError,QDBusMessage)));
+        }
+    }
+}
+
+void Ngf::DBusTransport::presenceReply(const QDBusMessage &reply)
+{
+    emit servicePresent(reply.arguments().value(0).toBool());
+}
+
+void Ngf::DBusTransport::presenceError(const QDBusError &error, const QDBusMessage &message)
+{
+    Q_UNUSED(message);
+
+    // Nothing is known then, Play calls will tell
+    qCWarning(m_log) << "Couldn't find out whether NGFD is on the bus" << error.message();
+}
+
+void Ngf::DBusTransport::serviceOwnerChanged(const QString &service, const QString &oldOwner,
+                                             const QString &newOwner)
+{
+    Q_UNUSED(service);
+
+    if (!oldOwner.isEmpty()) {
+        // Peer socket went away together with the daemon
+        closePeerConnection();
+        emit serviceAvailable(false);
+        emit serviceLost();
+        emit servicePresent(false);
+    }
+
+    if (!newOwner.isEmpty()) {
+        qCDebug(m_log) << "NGFD registered as" << newOwner;
+        emit servicePresent(true);
+    }
+}
+
+void Ngf::DBusTransport::warmUp(bool ping)
+{
+    openBus();
+    m_pingWanted = ping;
+
+    if (!m_peerConnection.isEmpty()) {
+        // Peer connection is to NGFD itself, no name to resolve
+        nameOwnerReply(QDBusMessage());
+        return;
+    }
+
+    QDBusMessage getNameOwner = QDBusMessage::createMethodCall(DBusService, DBusPath, DBusInterface,
+                                                               QStringLiteral("GetNameOwner"));
+    getNameOwner << NgfDestination;
+
+    if (!m_bus.callWithCallback(getNameOwner, this, SLOT(nameOwnerReply(QDBusMessage)),
+                                SLOT(nameOwnerError(QDBusError,QDBusMessage)))) {
+        emit serviceAvailable(false);
+    }
+}
+
+void Ngf::DBusTransport::nameOwnerReply(const QDBusMessage &reply)
+{
+    if (reply.type() == QDBusMessage::ReplyMessage)
+        qCDebug(m_log) << "NGFD is owned by" << reply.arguments().value(0).toString();
+
+    if (!m_pingWanted) {
+        emit serviceAvailable(true);
+        return;
+    }
+
+    // Round trip to NGFD itself, answered by its D-Bus library without bothering NGFD
+    QDBusMessage ping = QDBusMessage::createMethodCall(NgfDestination, NgfPath, PeerInterface,
+                                                       QStringLiteral("Ping"));
+    if (!m_connection.callWithCallback(ping, this, SLOT(pingReply(QDBusMessage)),
+                                       SLOT(pingError(QDBusError,QDBusMessage)))) {
+        emit serviceAvailable(false);
+    }
+}
+
+void Ngf::DBusTransport::nameOwnerError(const QDBusError &error, const QDBusMessage &message)
+{
+    Q_UNUSED(message);
+
+    qCDebug(m_log) << "NGFD is not on the bus" << error.message();
+    emit serviceAvailable(false);
+}
+
+void Ngf::DBusTransport::pingReply(const QDBusMessage &reply)
+{
+    Q_UNUSED(reply);
+
+    emit serviceAvailable(true);
+}
+
+void Ngf::DBusTransport::pingError(const QDBusError &error, const QDBusMessage &message)
+{
+    Q_UNUSED(message);
+
+    qCWarning(m_log) << "NGFD didn't answer ping" << error.message();
+    emit serviceAvailable(false);
+}
+
+QDBusMessage Ngf::DBusTransport::prepare(const QString &event, const Proplist &properties)
+{
+    QDBusMessage play = createMethodCall(MethodPlay);
+    play << event << properties;
+
+    return play;
+}
+
+void Ngf::DBusTransport::play(Event *event)
+{
+    // Create asynchronic call to NGFD. The reply is delivered to the reply tracker of the
+    // event slot, from where it ends up in reply() where it is finally determined if
+    // event is really running in the NGFD side.
+    if (!event->tracker)
+        event->tracker = new ReplyTracker(this, event);
+
+    openBus();
+
+    QDBusMessage play = event->message.type() == QDBusMessage::MethodCallMessage
+            ? event->message : prepare(event->name, event->properties);
+    m_bytesMarshalled += marshalledSize(play);
+
+    if (!m_connection.callWithCallback(play, event->tracker,
+                                       SLOT(reply(QDBusMessage)),
+                                       SLOT(error(QDBusError,QDBusMessage)))) {
+        // Report the failure asynchronously, like any other failed call
+        QMetaObject::invokeMethod(event->tracker, "cancel", Qt::QueuedConnection);
+    }
+}
+
+void Ngf::DBusTransport::reply(Event *event, const QDBusMessage &reply)
+{
+    // Play -method reply should contain one argument of type uint32 containing
+    // server side event id for started event.
+
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.signature() != QLatin1String("u")) {
+        // Starting event failed for some reason, reason can hopefully be determined from
+        // NGFD logs.
+        if (!m_peerConnection.isEmpty() && reply.errorName() == QLatin1String("org.freedesktop.DBus.Error.Disconnected"))
+            QMetaObject::invokeMethod(this, "peerDisconnected", Qt::QueuedConnection);
+        // Let the client know before the failure, so that it can hold on to the event
+        if (m_peerConnection.isEmpty()
+                && (reply.errorName() == QLatin1String("org.freedesktop.DBus.Error.ServiceUnknown")
+                    || reply.errorName() == QLatin1String("org.freedesktop.DBus.Error.NameHasNoOwner")))
+            emit servicePresent(false);
+        playReply(event, false, 0);
+    } else {
+        playReply(event, true, reply.arguments().at(0).toUInt());
+    }
+}
+
+bool Ngf::DBusTransport::playOneShot(const QString &event, const Proplist &properties,
+                                     const QDBusMessage &prepared)
+{
+    openBus();
+
+    // Method calls sent with send() are flagged as not expecting a reply, so NGFD
+    // doesn't send one and no event is created on the client side either.
+    QDBusMessage play = prepared.type() == QDBusMessage::MethodCallMessage
+            ? prepared : prepare(event, properties);
+    m_bytesMarshalled += marshalledSize(play);
+    bool sent = m_connection.send(play);
+    qCDebug(m_log) << "play one shot" << event << (sent ? "sent" : "failed");
+
+    return sent;
+}
+
+void Ngf::DBusTransport::pause(quint32 serverEventId, bool pause)
+{
+    QDBusMessage message = createMethodCall(MethodPause);
+    message << serverEventId << QVariant(pause);
+    m_bytesMarshalled += marshalledSize(message);
+
+    openBus();
+    m_connection.asyncCall(message);
+}
+
+void Ngf::DBusTransport::stop(quint32 serverEventId)
+{
+    QDBusMessage message = createMethodCall(MethodStop);
+    message << serverEventId;
+    m_bytesMarshalled += marshalledSize(message);
+
+    openBus();
+    m_connection.asyncCall(message);
+}
@@ -0,0 +1,132 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTDBUSTRANSPORT_H
+#define NGFCLIENTDBUSTRANSPORT_H
+
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDBusMessage>
+#include <QDBusServiceWatcher>
+#include "transport.h"
+
+namespace Ngf
+{
+    class DBusTransport;
+
+    // Receives the reply to the Play call of one event slot. Trackers live as long as
+    // their slot does, so they are reused instead of allocating a watcher for every call.
+    // They are children of the transport, so that they move with the client between threads.
+    class ReplyTracker : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        ReplyTracker(DBusTransport *transport, Event *event);
+        ~ReplyTracker();
+
+    public slots:
+        void reply(const QDBusMessage &message);
+        void error(const QDBusError &error, const QDBusMessage &message);
+        void cancel();
+
+    private:
+        DBusTransport * const m_transport;
+        Event * const m_event;
+    };
+
+    // Debug interface of the client on its bus connection, exported only when the process
+    // is started with NGF_CLIENT_DEBUG_DBUS set
+    class ClientDebug : public QObject
+    {
+        Q_OBJECT
+        Q_CLASSINFO("D-Bus Interface", "org.sailfishos.ngf.ClientDebug")
+
+    public:
+        ClientDebug(ClientPrivate *client);
+
+    public slots:
+        Q_SCRIPTABLE QString DumpFlightRecorder() const;
+
+    private:
+        ClientPrivate * const m_client;
+    };
+
+    // Talks to NGF daemon over the message bus, or over a peer connection when one is open.
+    class DBusTransport : public Transport
+    {
+        Q_OBJECT
+
+    public:
+        DBusTransport(ClientPrivate *client);
+        virtual ~DBusTransport();
+
+        bool openPrivateConnection(const QDBusConnection &connection);
+        bool openPeerConnection(const QString &address);
+
+        virtual void watch();
+        virtual void warmUp(bool ping);
+        virtual QDBusMessage prepare(const QString &event, const Proplist &properties);
+        virtual void play(Event *event);
+        virtual bool playOneShot(const QString &event, const Proplist &properties,
+                                 const QDBusMessage &prepared);
+        virtual void pause(quint32 serverEventId, bool pause);
+        virtual void stop(quint32 serverEventId);
+        virtual void setStatusWanted(bool wanted);
+
+    private slots:
+        void statusReceived(quint32 serverEventId, quint32 state);
+        void serviceOwnerChanged(const QString &service, const QString &oldOwner,
+                                 const QString &newOwner);
+        void peerDisconnected();
+        void nameOwnerReply(const QDBusMessage &reply);
+        void nameOwnerError(const QDBusError &error, const QDBusMessage &message);
+        void pingReply(const QDBusMessage &reply);
+        void pingError(const QDBusError &error, const QDBusMessage &message);
+        void presenceReply(const QDBusMessage &reply);
+        void presenceError(const QDBusError &error, const QDBusMessage &message);
+
+    private:
+        friend class ReplyTracker;
+
+        void reply(Event *event, const QDBusMessage &reply);
+        void openBus();
+        void closePrivateConnection();
+        void closePeerConnection();
+        void subscribeStatus();
+        void unsubscribeStatus();
+        void exportDebug();
+        void unexportDebug();
+
+        QDBusConnection m_bus;          // Message bus NGFD is on
+        QDBusConnection m_connection;   // Where requests and Status go, the bus or a peer
+        bool m_busOpen;                 // System bus is connected to on first use
+        QString m_privateConnection;    // Name of the bus connection owned by the client, if any
+        QString m_peerConnection;       // Name of the peer connection to NGFD, if any
+        bool m_statusWanted;
+        bool m_statusSubscribed;
+        QString m_statusSender;         // Sender the Status subscription is limited to
+        QDBusServiceWatcher *m_serviceWatcher;
+        bool m_pingWanted;              // Warm up pings NGFD once its name owner is known
+        ClientDebug *m_debug;           // Exported on the bus while it is open, if wanted
+    };
+}
+
+#endif
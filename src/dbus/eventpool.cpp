@@ -0,0 +1,77 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "eventpool.h"
+#include "dbustransport.h"
+
+Ngf::Event::~Event()
+{
+    delete tracker;
+}
+
+Ngf::EventPool::EventPool()
+{
+}
+
+Ngf::EventPool::~EventPool()
+{
+    foreach (Event *chunk, m_chunks)
+        delete[] chunk;
+}
+
+Ngf::Event *Ngf::EventPool::acquire(const QString &name, quint32 clientEventId)
+{
+    if (m_free.isEmpty())
+        grow();
+
+    Event *event = m_free.takeLast();
+    event->reset(name, clientEventId);
+    return event;
+}
+
+void Ngf::EventPool::release(Event *event)
+{
+    // Drop the name, properties and message so that the pool doesn't keep them alive
+    event->name.clear();
+    event->properties.clear();
+    event->message = QDBusMessage();
+    m_free.append(event);
+}
+
+int Ngf::EventPool::capacity() const
+{
+    return m_chunks.size() * ChunkSize;
+}
+
+int Ngf::EventPool::used() const
+{
+    return capacity() - m_free.size();
+}
+
+void Ngf::EventPool::grow()
+{
+    Event *chunk = new Event[ChunkSize];
+    m_chunks.append(chunk);
+
+    // Make room for the whole pool up front, release() must not reallocate
+    m_free.reserve(capacity());
+    for (int i = ChunkSize - 1; i >= 0; --i)
+        m_free.append(&chunk[i]);
+}
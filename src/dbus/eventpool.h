@@ -0,0 +1,114 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTEVENTPOOL_H
+#define NGFCLIENTEVENTPOOL_H
+
+#include <QObject>
+#include <QDBusMessage>
+#include <QString>
+#include <QVector>
+#include "clientprivate.h"
+
+namespace Ngf
+{
+    class ReplyTracker;
+
+    class Event
+    {
+    public:
+        Event()
+            : clientEventId(0), serverEventId(0), batchId(0),
+              wantedState(ClientPrivate::StatePlaying),
+              activeState(ClientPrivate::StateNew),
+              pendingState(ClientPrivate::StateNew),
+              priority(Client::NormalPriority), deadline(0), parkedUntil(0), tracker(0),
+              staged(false), parked(false), callPending(false), orphaned(false)
+        {}
+        ~Event();
+
+        void reset(const QString &_name, quint32 _clientEventId)
+        {
+            name = _name;
+            clientEventId = _clientEventId;
+            serverEventId = 0;
+            batchId = 0;
+            wantedState = ClientPrivate::StatePlaying;
+            activeState = ClientPrivate::StateNew;
+            pendingState = ClientPrivate::StateNew;
+            priority = Client::NormalPriority;
+            deadline = 0;
+            parkedUntil = 0;
+            staged = false;
+            parked = false;
+            callPending = false;
+            orphaned = false;
+        }
+
+        QString name;
+        Proplist properties;
+        quint32 clientEventId;
+        quint32 serverEventId;
+        quint32 batchId;
+        ClientPrivate::EventState wantedState;
+        ClientPrivate::EventState activeState;
+        ClientPrivate::EventState pendingState;
+        QDBusMessage message; // Prepared Play call, if any
+        Client::Priority priority;
+        qint64 deadline;      // When the event has to be playing by, 0 if never
+        qint64 parkedUntil;   // When a parked event is given up on
+        ReplyTracker *tracker; // Created by the D-Bus transport on first use
+        bool staged;        // Waiting for dispatch, nothing sent yet
+        bool parked;        // Waiting for NGFD to appear, nothing sent yet
+        bool callPending;   // Play call sent, reply not yet received
+        bool orphaned;      // Removed from the client while the call was pending
+
+    private:
+        Q_DISABLE_COPY(Event)
+    };
+
+    // Free list of event slots. Slots are allocated in chunks and never freed before
+    // the pool itself, so once the pool has grown to the working set size acquiring
+    // and releasing events doesn't touch the heap.
+    class EventPool
+    {
+    public:
+        EventPool();
+        ~EventPool();
+
+        Event *acquire(const QString &name, quint32 clientEventId);
+        void release(Event *event);
+
+        int capacity() const;
+        int used() const;
+
+    private:
+        void grow();
+
+        enum { ChunkSize = 16 };
+
+        QVector<Event*> m_chunks;
+        QVector<Event*> m_free;
+
+        Q_DISABLE_COPY(EventPool)
+    };
+}
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <atomic>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QDebug>
+
+#include "flightrecorder.h"
+
+namespace {
+
+// Recorders of the live clients, for dumping them all from a signal handler
+enum { MaxRecorders = 16 };
+QBasicAtomicPointer<Ngf::FlightRecorder> recorders[MaxRecorders];
+// Clients beyond the above, mentioned in dumps so that they aren't mistaken for complete
+QBasicAtomicInt unregistered = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+const char * const operationNames[Ngf::FlightRecorder::OperationCount] = {
+    "play",
+    "play-one-shot",
+    "suppress",
+    "dispatch",
+    "reply",
+    "status",
+    "pause",
+    "resume",
+    "stop",
+    "request",
+    "elide",
+    "park",
+    "fail"
+};
+
+// snprintf() isn't async-signal-safe, lines are put together by hand
+char *appendString(char *out, const char *string)
+{
+    while (*string)
+        *out++ = *string++;
+    return out;
+}
+
+char *appendNumber(char *out, quint64 number)
+{
+    char digits[20];
+    int count = 0;
+
+    do {
+        digits[count++] = char('0' + number % 10);
+        number /= 10;
+    } while (number);
+
+    while (count)
+        *out++ = digits[--count];
+    return out;
+}
+
+struct FdSink {
+    int fd;
+
+    void append(const char *data, int size)
+    {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size_t(size));
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return;
+            data += written;
+            size -= int(written);
+        }
+    }
+};
+
+struct StringSink {
+    QString string;
+
+    void append(const char *data, int size)
+    {
+        string.append(QLatin1String(data, size));
+    }
+};
+
+void dumpAllOnSignal(int)
+{
+    const int savedErrno = errno;
+    Ngf::FlightRecorder::dumpAll(STDERR_FILENO);
+    errno = savedErrno;
+}
+
+}
+
+Ngf::FlightRecorder::FlightRecorder(const QElapsedTimer &clock)
+    : m_clock(clock),
+      m_next(0)
+{
+    for (int i = 0; i < MaxRecorders; ++i) {
+        if (recorders[i].testAndSetOrdered(0, this))
+            return;
+    }
+
+    unregistered.fetchAndAddOrdered(1);
+    qWarning() << "More than" << int(MaxRecorders)
+               << "NGF clients, history of this one is left out of signal dumps";
+}
+
+Ngf::FlightRecorder::~FlightRecorder()
+{
+    for (int i = 0; i < MaxRecorders; ++i) {
+        if (recorders[i].testAndSetOrdered(this, 0))
+            return;
+    }
+
+    unregistered.fetchAndAddOrdered(-1);
+}
+
+template <typename Sink>
+void Ngf::FlightRecorder::dump(Sink &sink) const
+{
+    const quint32 last = m_next.loadAcquire();
+    const quint32 first = last > Capacity ? last - Capacity + 1 : 1;
+
+    for (quint32 sequence = first; sequence && sequence <= last; ++sequence) {
+        const Entry &entry = m_entries[sequence & (Capacity - 1)];
+
+        if (entry.sequence.loadAcquire() != sequence)
+            continue;
+        const quint8 operation = entry.operation;
+        const qint64 time = entry.time;
+        const quint32 clientEventId = entry.clientEventId;
+        const quint32 serverEventId = entry.serverEventId;
+        const quint32 value = entry.value;
+        // Overwritten while it was being read
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.loadAcquire() != sequence || operation >= OperationCount)
+            continue;
+
+        // <time [us]> <operation> <client event id> <server event id> <value>
+        char line[128];
+        char *out = appendNumber(line, quint64(time / 1000));
+        out = appendString(out, " ");
+        out = appendString(out, operationNames[operation]);
+        out = appendString(out, " ");
+        out = appendNumber(out, clientEventId);
+        out = appendString(out, " ");
+        out = appendNumber(out, serverEventId);
+        out = appendString(out, " ");
+        out = appendNumber(out, value);
+        out = appendString(out, "\n");
+        sink.append(line, int(out - line));
+    }
+}
+
+QString Ngf::FlightRecorder::dump() const
+{
+    StringSink sink;
+    dump(sink);
+    return sink.string;
+}
+
+void Ngf::FlightRecorder::dump(int fd) const
+{
+    FdSink sink = { fd };
+    dump(sink);
+}
+
+void Ngf::FlightRecorder::dumpAll(int fd)
+{
+    FdSink sink = { fd };
+
+    for (int i = 0; i < MaxRecorders; ++i) {
+        const FlightRecorder *recorder = recorders[i].loadAcquire();
+        if (!recorder)
+            continue;
+
+        char header[64];
+        char *out = appendString(header, "ngf-qt flight recorder ");
+        out = appendNumber(out, quint64(i));
+        out = appendString(out, ":\n");
+        sink.append(header, int(out - header));
+        recorder->dump(sink);
+    }
+
+    const int missing = unregistered.loadAcquire();
+    if (missing > 0) {
+        char footer[64];
+        char *out = appendString(footer, "ngf-qt flight recorder: ");
+        out = appendNumber(out, quint64(missing));
+        out = appendString(out, " clients left out\n");
+        sink.append(footer, int(out - footer));
+    }
+}
+
+bool Ngf::FlightRecorder::dumpOnSignal(int signal)
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = dumpAllOnSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    return sigaction(signal, &action, 0) == 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTFLIGHTRECORDER_H
+#define NGFCLIENTFLIGHTRECORDER_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QString>
+
+namespace Ngf
+{
+    // Last operations and state changes of a client, always on. Recording takes a slot
+    // with one atomic increment and fills it in place, from any thread and without
+    // locking or allocating. Slots carry a sequence number, so that a dump made while
+    // they are being written skips the ones that aren't complete.
+    class FlightRecorder
+    {
+    public:
+        enum Operation {
+            Play,           // value: priority
+            PlayOneShot,
+            Suppress,       // Play refused by a rate limit
+            Dispatch,       // Play sent to NGFD
+            Reply,          // value: 1 if NGFD started the event
+            Status,         // value: state from NGFD
+            Pause,
+            Resume,
+            Stop,
+            Request,        // Pause, resume or stop sent to NGFD, value: wanted state
+            Elide,          // Stopped before Play was sent
+            Park,           // Held back until NGFD is on the bus
+            Fail,           // Failed by the client, value: 1 for deadline, 0 offline
+            OperationCount
+        };
+
+        enum { Capacity = 512 };    // Power of two
+
+        explicit FlightRecorder(const QElapsedTimer &clock);
+        ~FlightRecorder();
+
+        void record(Operation operation, quint32 clientEventId, quint32 serverEventId = 0,
+                    quint32 value = 0)
+        {
+            const quint32 sequence = m_next.fetchAndAddRelaxed(1) + 1;
+            Entry &entry = m_entries[sequence & (Capacity - 1)];
+
+            // Readers see 0 while the slot is being written
+            entry.sequence.fetchAndStoreAcquire(0);
+            entry.time = m_clock.nsecsElapsed();
+            entry.operation = quint8(operation);
+            entry.clientEventId = clientEventId;
+            entry.serverEventId = serverEventId;
+            entry.value = value;
+            entry.sequence.storeRelease(sequence);
+        }
+
+        // Oldest first, one line for each operation
+        QString dump() const;
+        // Same without allocating, for signal handlers
+        void dump(int fd) const;
+
+        // Writes every recorder of the process to fd, async-signal-safe
+        static void dumpAll(int fd);
+        // Dump every recorder to stderr when the process gets the signal
+        static bool dumpOnSignal(int signal);
+
+    private:
+        struct Entry {
+            QAtomicInteger<quint32> sequence;
+            quint8 operation;
+            qint64 time;    // [ns] Client clock
+            quint32 clientEventId;
+            quint32 serverEventId;
+            quint32 value;
+        };
+
+        template <typename Sink> void dump(Sink &sink) const;
+
+        const QElapsedTimer &m_clock;
+        QAtomicInteger<quint32> m_next;
+        Entry m_entries[Capacity];
+
+        Q_DISABLE_COPY(FlightRecorder)
+    };
+}
+
+#endif
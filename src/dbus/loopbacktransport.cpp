@@ -0,0 +1,159 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "loopbacktransport.h"
+#include "eventpool.h"
+
+Ngf::LoopbackTransport::LoopbackTransport(ClientPrivate *client, int replyDelay, int statusDelay,
+                                          int duration)
+    : Transport(client),
+      m_replyDelay(replyDelay),
+      m_statusDelay(statusDelay),
+      m_duration(duration),
+      m_serverEventId(0),
+      m_deliveryScheduled(false),
+      m_timer(new QTimer(this))
+{
+    m_clock.start();
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    QObject::connect(m_timer, SIGNAL(timeout()), this, SLOT(deliver()));
+}
+
+void Ngf::LoopbackTransport::watch()
+{
+}
+
+void Ngf::LoopbackTransport::warmUp(bool ping)
+{
+    Q_UNUSED(ping);
+
+    // Always there
+    QMetaObject::invokeMethod(this, "serviceAvailable", Qt::QueuedConnection, Q_ARG(bool, true));
+}
+
+void Ngf::LoopbackTransport::play(Event *event)
+{
+    Operation reply = { event, 0, 0 };
+    post(m_replyDelay, reply);
+}
+
+bool Ngf::LoopbackTransport::playOneShot(const QString &event, const Proplist &properties,
+                                         const QDBusMessage &prepared)
+{
+    Q_UNUSED(properties);
+    Q_UNUSED(prepared);
+
+    qCDebug(m_log) << "loopback: play one shot" << event;
+
+    return true;
+}
+
+void Ngf::LoopbackTransport::pause(quint32 serverEventId, bool pause)
+{
+    if (m_live.contains(serverEventId)) {
+        Operation status = { 0, serverEventId, quint32(pause ? StatusEventPaused : StatusEventPlaying) };
+        post(m_statusDelay, status);
+    }
+}
+
+void Ngf::LoopbackTransport::stop(quint32 serverEventId)
+{
+    if (m_live.contains(serverEventId)) {
+        Operation status = { 0, serverEventId, quint32(StatusEventCompleted) };
+        post(m_statusDelay, status);
+    }
+}
+
+void Ngf::LoopbackTransport::post(int delay, const Operation &operation)
+{
+    if (delay <= 0) {
+        m_ready.append(operation);
+        if (!m_deliveryScheduled) {
+            m_deliveryScheduled = true;
+            QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+        }
+        return;
+    }
+
+    const qint64 due = m_clock.elapsed() + delay;
+    m_timed.insert(due, operation);
+
+    // Rearm only when the new operation is the first one due
+    if (m_timed.constBegin().key() == due && (!m_timer->isActive() || m_timer->remainingTime() > delay))
+        m_timer->start(delay);
+}
+
+void Ngf::LoopbackTransport::deliver()
+{
+    m_deliveryScheduled = false;
+
+    const qint64 now = m_clock.elapsed();
+    QList<Operation> operations;
+    operations.swap(m_ready);
+
+    QMultiMap<qint64, Operation>::iterator timed = m_timed.begin();
+    while (timed != m_timed.end() && timed.key() <= now) {
+        operations.append(timed.value());
+        timed = m_timed.erase(timed);
+    }
+
+    // Whatever the operations post is delivered on a later round
+    foreach (const Operation &operation, operations)
+        run(operation);
+
+    if (!m_timed.isEmpty())
+        m_timer->start(int(qMax<qint64>(0, m_timed.constBegin().key() - m_clock.elapsed())));
+}
+
+void Ngf::LoopbackTransport::run(const Operation &operation)
+{
+    if (operation.event) {
+        // Nothing to play for an event the client has already dropped
+        if (operation.event->orphaned) {
+            playReply(operation.event, false, 0);
+            return;
+        }
+
+        if (++m_serverEventId == 0)
+            ++m_serverEventId;
+        const quint32 serverEventId = m_serverEventId;
+        m_live.insert(serverEventId);
+
+        qCDebug(m_log) << "loopback: playing" << operation.event->name << serverEventId;
+        playReply(operation.event, true, serverEventId);
+
+        if (m_duration >= 0) {
+            Operation completed = { 0, serverEventId, quint32(StatusEventCompleted) };
+            post(m_duration, completed);
+        }
+        return;
+    }
+
+    if (operation.state == StatusEventCompleted || operation.state == StatusEventFailed) {
+        // Event may have been stopped and completed on its own, only the first one counts
+        if (!m_live.remove(operation.serverEventId))
+            return;
+    } else if (!m_live.contains(operation.serverEventId)) {
+        return;
+    }
+
+    emit status(operation.serverEventId, operation.state);
+}
@@ -0,0 +1,81 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTLOOPBACKTRANSPORT_H
+#define NGFCLIENTLOOPBACKTRANSPORT_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMultiMap>
+#include <QSet>
+#include <QTimer>
+#include "transport.h"
+
+namespace Ngf
+{
+    // Stands in for NGF daemon within the process. Events go through the same state
+    // transitions NGFD would make, after the configured delays, and nothing leaves
+    // the process. Meant for running without the daemon and for load testing the client.
+    class LoopbackTransport : public Transport
+    {
+        Q_OBJECT
+
+    public:
+        // Delays are in milliseconds, negative duration makes events play until stopped
+        LoopbackTransport(ClientPrivate *client, int replyDelay, int statusDelay, int duration);
+
+        virtual void watch();
+        virtual void warmUp(bool ping);
+        virtual void play(Event *event);
+        virtual bool playOneShot(const QString &event, const Proplist &properties,
+                                 const QDBusMessage &prepared);
+        virtual void pause(quint32 serverEventId, bool pause);
+        virtual void stop(quint32 serverEventId);
+
+    private slots:
+        void deliver();
+
+    private:
+        // Reply to Play when event is set, otherwise Status of a server event
+        struct Operation {
+            Event *event;
+            quint32 serverEventId;
+            quint32 state;
+        };
+
+        void post(int delay, const Operation &operation);
+        void run(const Operation &operation);
+
+        const int m_replyDelay;
+        const int m_statusDelay;
+        const int m_duration;
+        quint32 m_serverEventId;
+        QSet<quint32> m_live;       // Server ids of events the "daemon" is playing
+        // Operations without delay are delivered on the next event loop iteration,
+        // the rest once their time is up.
+        QList<Operation> m_ready;
+        QMultiMap<qint64, Operation> m_timed;
+        bool m_deliveryScheduled;
+        QElapsedTimer m_clock;
+        QTimer *m_timer;
+    };
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "ngfpreparedevent.h"
+#include "preparedeventprivate.h"
+
+Ngf::PreparedEvent::PreparedEvent()
+{
+}
+
+Ngf::PreparedEvent::PreparedEvent(PreparedEventPrivate *dd)
+    : d(dd)
+{
+}
+
+Ngf::PreparedEvent::PreparedEvent(const PreparedEvent &other)
+    : d(other.d)
+{
+}
+
+Ngf::PreparedEvent::~PreparedEvent()
+{
+}
+
+Ngf::PreparedEvent &Ngf::PreparedEvent::operator=(const PreparedEvent &other)
+{
+    d = other.d;
+    return *this;
+}
+
+bool Ngf::PreparedEvent::isValid() const
+{
+    return d.data() != 0;
+}
+
+QString Ngf::PreparedEvent::event() const
+{
+    return d ? d->name : QString();
+}
+
+QMap<QString, QVariant> Ngf::PreparedEvent::properties() const
+{
+    return d ? d->properties : QMap<QString, QVariant>();
+}
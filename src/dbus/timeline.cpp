@@ -0,0 +1,153 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QVariantList>
+#include <algorithm>
+#include "timeline.h"
+
+Ngf::LatencySamples::LatencySamples()
+    : m_next(0)
+{
+}
+
+void Ngf::LatencySamples::add(qint64 latency)
+{
+    if (m_samples.size() < Size)
+        m_samples.append(latency);
+    else
+        m_samples[m_next] = latency;
+
+    m_next = (m_next + 1) % Size;
+}
+
+QVariantMap Ngf::LatencySamples::percentiles() const
+{
+    QVector<qint64> sorted = m_samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    QVariantMap result;
+    result.insert(QStringLiteral("samples"), sorted.size());
+
+    if (!sorted.isEmpty()) {
+        // Nearest rank
+        const int n = sorted.size();
+        result.insert(QStringLiteral("p50"), sorted.at((50 * n + 99) / 100 - 1) / 1000);
+        result.insert(QStringLiteral("p95"), sorted.at((95 * n + 99) / 100 - 1) / 1000);
+        result.insert(QStringLiteral("p99"), sorted.at((99 * n + 99) / 100 - 1) / 1000);
+    }
+
+    return result;
+}
+
+void Ngf::Timelines::played(quint32 clientEventId, const QString &name, qint64 time)
+{
+    Timeline &timeline = m_timelines[clientEventId];
+    timeline.name = name;
+    timeline.played = time;
+
+    m_order.enqueue(clientEventId);
+    if (m_order.size() > History)
+        m_timelines.remove(m_order.dequeue());
+}
+
+void Ngf::Timelines::sent(quint32 clientEventId, qint64 time)
+{
+    QHash<quint32, Timeline>::iterator timeline = m_timelines.find(clientEventId);
+    if (timeline == m_timelines.end())
+        return;
+
+    // Parked events are sent again once NGFD is back, the last send counts
+    timeline->sent = time;
+    sample(timeline->name, "dispatch", time - timeline->played);
+}
+
+void Ngf::Timelines::replied(quint32 clientEventId, quint32 serverEventId, qint64 time)
+{
+    QHash<quint32, Timeline>::iterator timeline = m_timelines.find(clientEventId);
+    if (timeline == m_timelines.end())
+        return;
+
+    timeline->replied = time;
+    timeline->serverEventId = serverEventId;
+    sample(timeline->name, "reply", time - timeline->sent);
+    sample(timeline->name, "start", time - timeline->played);
+}
+
+void Ngf::Timelines::status(quint32 clientEventId, quint32 state, qint64 time)
+{
+    QHash<quint32, Timeline>::iterator timeline = m_timelines.find(clientEventId);
+    if (timeline == m_timelines.end())
+        return;
+
+    // Time since the previous point on the timeline
+    qint64 previous = timeline->status.isEmpty() ? timeline->replied : timeline->status.last().second;
+    timeline->status.append(qMakePair(state, time));
+    sample(timeline->name, "status", time - previous);
+}
+
+QVariantMap Ngf::Timelines::timeline(quint32 clientEventId) const
+{
+    QVariantMap result;
+
+    QHash<quint32, Timeline>::const_iterator timeline = m_timelines.constFind(clientEventId);
+    if (timeline == m_timelines.constEnd())
+        return result;
+
+    result.insert(QStringLiteral("event"), timeline->name);
+    result.insert(QStringLiteral("played"), timeline->played / 1000);
+    if (timeline->sent)
+        result.insert(QStringLiteral("sent"), timeline->sent / 1000);
+    if (timeline->replied) {
+        result.insert(QStringLiteral("replied"), timeline->replied / 1000);
+        result.insert(QStringLiteral("serverEventId"), timeline->serverEventId);
+    }
+
+    QVariantList status;
+    for (int i = 0; i < timeline->status.size(); ++i) {
+        QVariantMap change;
+        change.insert(QStringLiteral("state"), timeline->status.at(i).first);
+        change.insert(QStringLiteral("time"), timeline->status.at(i).second / 1000);
+        status.append(change);
+    }
+    result.insert(QStringLiteral("status"), status);
+
+    return result;
+}
+
+QVariantMap Ngf::Timelines::latencies() const
+{
+    QVariantMap result;
+
+    QHash<QString, QHash<QString, LatencySamples> >::const_iterator event;
+    for (event = m_latencies.constBegin(); event != m_latencies.constEnd(); ++event) {
+        QVariantMap stages;
+        QHash<QString, LatencySamples>::const_iterator stage;
+        for (stage = event->constBegin(); stage != event->constEnd(); ++stage)
+            stages.insert(stage.key(), stage->percentiles());
+        result.insert(event.key(), stages);
+    }
+
+    return result;
+}
+
+void Ngf::Timelines::sample(const QString &name, const char *stage, qint64 latency)
+{
+    m_latencies[name][QLatin1String(stage)].add(latency);
+}
@@ -0,0 +1,85 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTTIMELINE_H
+#define NGFCLIENTTIMELINE_H
+
+#include <QHash>
+#include <QPair>
+#include <QQueue>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+namespace Ngf
+{
+    // Latency samples of one stage, the latest ones only. Percentiles are worked out
+    // when asked, recording is just a store.
+    class LatencySamples
+    {
+    public:
+        enum { Size = 128 };
+
+        LatencySamples();
+
+        void add(qint64 latency);
+        QVariantMap percentiles() const;
+
+    private:
+        QVector<qint64> m_samples;
+        int m_next;
+    };
+
+    // Timestamps of recently played events, and latency percentiles per event name and
+    // stage. Times are client clock nanoseconds, reported in microseconds.
+    class Timelines
+    {
+    public:
+        enum { History = 256 };     // Timelines kept, oldest ones are forgotten first
+
+        void played(quint32 clientEventId, const QString &name, qint64 time);
+        void sent(quint32 clientEventId, qint64 time);
+        void replied(quint32 clientEventId, quint32 serverEventId, qint64 time);
+        void status(quint32 clientEventId, quint32 state, qint64 time);
+
+        QVariantMap timeline(quint32 clientEventId) const;
+        QVariantMap latencies() const;
+
+    private:
+        struct Timeline {
+            Timeline() : played(0), sent(0), replied(0), serverEventId(0) {}
+
+            QString name;
+            qint64 played;
+            qint64 sent;
+            qint64 replied;
+            quint32 serverEventId;
+            QVector<QPair<quint32, qint64> > status;
+        };
+
+        void sample(const QString &name, const char *stage, qint64 latency);
+
+        QHash<quint32, Timeline> m_timelines;
+        QQueue<quint32> m_order;
+        QHash<QString, QHash<QString, LatencySamples> > m_latencies;
+    };
+}
+
+#endif
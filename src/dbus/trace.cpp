@@ -0,0 +1,172 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "tracewriter.h"
+
+namespace Ngf
+{
+    class TraceReaderPrivate
+    {
+    public:
+        QFile file;
+        QDataStream stream;
+    };
+}
+
+namespace {
+
+// Header: magic, format version. Records: type, time and the members of the type. Names
+// are UTF-8, the stream version is fixed so that traces move between Qt versions.
+const quint32 TraceMagic = 0x4e474654;  // NGFT
+const quint16 TraceVersion = 1;
+const QDataStream::Version StreamVersion = QDataStream::Qt_5_6;
+
+}
+
+Ngf::TraceWriter::TraceWriter()
+{
+}
+
+Ngf::TraceWriter::~TraceWriter()
+{
+    m_file.close();
+}
+
+bool Ngf::TraceWriter::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(StreamVersion);
+    m_stream << TraceMagic << TraceVersion;
+
+    return m_stream.status() == QDataStream::Ok;
+}
+
+bool Ngf::TraceWriter::write(const TraceRecord &record)
+{
+    m_stream << quint8(record.type) << record.time;
+
+    switch (record.type) {
+    case TraceRecord::Play:
+        m_stream << record.eventId << record.event.toUtf8() << record.properties
+                 << qint8(record.priority) << qint32(record.deadline);
+        break;
+    case TraceRecord::PlayOneShot:
+        m_stream << record.event.toUtf8() << record.properties;
+        break;
+    case TraceRecord::Pause:
+    case TraceRecord::Resume:
+    case TraceRecord::Stop:
+        m_stream << record.eventId << record.event.toUtf8();
+        break;
+    case TraceRecord::Reply:
+        m_stream << record.eventId << record.ok << record.serverEventId;
+        break;
+    case TraceRecord::Status:
+        m_stream << record.serverEventId << record.state << record.eventId;
+        break;
+    }
+
+    return m_stream.status() == QDataStream::Ok;
+}
+
+bool Ngf::TraceWriter::close()
+{
+    // A full disk may only show up once buffered records are written out
+    bool flushed = m_file.flush();
+    m_file.close();
+
+    return flushed && m_stream.status() == QDataStream::Ok;
+}
+
+Ngf::TraceReader::TraceReader()
+    : d(new TraceReaderPrivate)
+{
+}
+
+Ngf::TraceReader::~TraceReader()
+{
+    delete d;
+}
+
+bool Ngf::TraceReader::open(const QString &fileName)
+{
+    d->file.close();
+    d->file.setFileName(fileName);
+    if (!d->file.open(QIODevice::ReadOnly))
+        return false;
+
+    d->stream.setDevice(&d->file);
+    d->stream.setVersion(StreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    d->stream >> magic >> version;
+
+    return d->stream.status() == QDataStream::Ok && magic == TraceMagic
+            && version == TraceVersion;
+}
+
+bool Ngf::TraceReader::next(TraceRecord *record)
+{
+    if (!d->file.isOpen() || d->stream.atEnd())
+        return false;
+
+    quint8 type = 0;
+    QByteArray event;
+    qint8 priority = 0;
+    qint32 deadline = 0;
+
+    *record = TraceRecord();
+    d->stream >> type >> record->time;
+
+    switch (type) {
+    case TraceRecord::Play:
+        d->stream >> record->eventId >> event >> record->properties >> priority >> deadline;
+        break;
+    case TraceRecord::PlayOneShot:
+        d->stream >> event >> record->properties;
+        break;
+    case TraceRecord::Pause:
+    case TraceRecord::Resume:
+    case TraceRecord::Stop:
+        d->stream >> record->eventId >> event;
+        break;
+    case TraceRecord::Reply:
+        d->stream >> record->eventId >> record->ok >> record->serverEventId;
+        break;
+    case TraceRecord::Status:
+        d->stream >> record->serverEventId >> record->state >> record->eventId;
+        break;
+    default:
+        // Written by a later version, nothing after it can be trusted
+        return false;
+    }
+
+    record->type = TraceRecord::Type(type);
+    record->event = QString::fromUtf8(event);
+    record->priority = priority;
+    record->deadline = deadline;
+
+    return d->stream.status() == QDataStream::Ok;
+}
@@ -0,0 +1,53 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTTRACEPOINTS_H
+#define NGFCLIENTTRACEPOINTS_H
+
+// Static tracepoints of the play, reply and status path, for following the client in
+// system wide traces next to NGFD. Built only with CONFIG+=ngf_tracepoints, and expand
+// to nothing otherwise, arguments included. When built in, each one is a single nop
+// until a tracer attaches to it, e.g.
+//
+//   perf probe -x libngf-qt5.so.1 sdt_libngf_qt:reply
+//
+// Tracepoints of provider libngf_qt and their arguments:
+//
+//   play           client event id, priority, deadline [ms on the client clock]
+//   dispatch       client event id, priority
+//   reply          client event id, ok, server event id
+//   status         client event id, server event id, state from NGFD
+//   request_state  client event id, server event id, wanted state
+
+#ifdef NGF_TRACEPOINTS
+
+#include <sys/sdt.h>
+
+#define NGF_TRACE2(name, a1, a2)            DTRACE_PROBE2(libngf_qt, name, a1, a2)
+#define NGF_TRACE3(name, a1, a2, a3)        DTRACE_PROBE3(libngf_qt, name, a1, a2, a3)
+
+#else
+
+#define NGF_TRACE2(name, a1, a2)            do { } while (0)
+#define NGF_TRACE3(name, a1, a2, a3)        do { } while (0)
+
+#endif
+
+#endif
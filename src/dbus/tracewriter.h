@@ -0,0 +1,49 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTTRACEWRITER_H
+#define NGFCLIENTTRACEWRITER_H
+
+#include <QDataStream>
+#include <QFile>
+#include "ngftrace.h"
+
+namespace Ngf
+{
+    // Trace file is a header followed by records back to back, see trace.cpp
+    class TraceWriter
+    {
+    public:
+        TraceWriter();
+        ~TraceWriter();
+
+        bool open(const QString &fileName);
+        bool write(const TraceRecord &record);
+        bool close();
+
+    private:
+        QFile m_file;
+        QDataStream m_stream;
+
+        Q_DISABLE_COPY(TraceWriter)
+    };
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "transport.h"
+
+Ngf::Transport::Transport(ClientPrivate *client)
+    : QObject(client),
+      m_client(client),
+      m_log(client->m_log),
+      m_bytesMarshalled(0)
+{
+}
+
+Ngf::Transport::~Transport()
+{
+}
+
+QDBusMessage Ngf::Transport::prepare(const QString &event, const Proplist &properties)
+{
+    Q_UNUSED(event);
+    Q_UNUSED(properties);
+
+    return QDBusMessage();
+}
+
+void Ngf::Transport::setStatusWanted(bool wanted)
+{
+    Q_UNUSED(wanted);
+}
+
+void Ngf::Transport::playReply(Event *event, bool ok, quint32 serverEventId)
+{
+    m_client->playReply(event, ok, serverEventId);
+}
@@ -0,0 +1,89 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGFCLIENTTRANSPORT_H
+#define NGFCLIENTTRANSPORT_H
+
+#include <QObject>
+#include <QDBusMessage>
+#include <QLoggingCategory>
+#include "clientprivate.h"
+
+namespace Ngf
+{
+    class Event;
+
+    enum NgfStatusId
+    {
+        StatusEventFailed       = 0,
+        StatusEventCompleted    = 1,
+        StatusEventPlaying      = 2,
+        StatusEventPaused       = 3,
+    };
+
+    // Wire layer between the client state machine and NGF daemon. Requests are
+    // fire and forget, the outcome of Play is reported with playReply() and state
+    // changes of playing events with the status() signal, both using server event ids.
+    class Transport : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        Transport(ClientPrivate *client);
+        virtual ~Transport();
+
+        // Start following NGF daemon, status() and servicePresent() aren't emitted before this
+        virtual void watch() = 0;
+        // Set up everything needed for talking to NGF daemon and find out whether it's
+        // there, answered with serviceAvailable()
+        virtual void warmUp(bool ping) = 0;
+        // Ready made Play call for prepared events, empty if the transport has no use for one
+        virtual QDBusMessage prepare(const QString &event, const Proplist &properties);
+        // Play the event, message of the event is used if prepared
+        virtual void play(Event *event) = 0;
+        virtual bool playOneShot(const QString &event, const Proplist &properties,
+                                 const QDBusMessage &prepared) = 0;
+        virtual void pause(quint32 serverEventId, bool pause) = 0;
+        virtual void stop(quint32 serverEventId) = 0;
+        // Whether status() is of interest, client has no events to follow when it isn't
+        virtual void setStatusWanted(bool wanted);
+
+        // Approximate size of everything sent so far
+        quint64 bytesMarshalled() const { return m_bytesMarshalled; }
+
+    signals:
+        void status(quint32 serverEventId, quint32 state);
+        // NGF daemon went away, all its events are gone
+        void serviceLost();
+        void serviceAvailable(bool available);
+        // NGF daemon registered on or vanished from the bus, Play can't succeed without it
+        void servicePresent(bool present);
+
+    protected:
+        // Every play() must be answered with exactly one playReply()
+        void playReply(Event *event, bool ok, quint32 serverEventId);
+
+        ClientPrivate * const m_client;
+        const QLoggingCategory &m_log;
+        quint64 m_bytesMarshalled;
+    };
+}
+
+#endif
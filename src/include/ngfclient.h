@@ -26,6 +26,10 @@
 #include <QString>
 #include <QVariant>
 #include "ngfclient_global.h"
+#include "ngfclientstats.h"
+#include "ngfeventrequest.h"
+#include "ngfpreparedevent.h"
+#include "ngftrace.h"
 
 namespace Ngf
 {
@@ -49,6 +53,15 @@ namespace Ngf
      * NGF::Client is introduced to allow simple use of NGF daemon without the need to know communication
      * details between daemon and client.
      *
+     * play(), playOneShot(), playBatch(), pause(), resume(), stop(), setRateLimit() and
+     * setTimelinesEnabled() can be called from any thread. Calls made from other threads than
+     * the one the client runs in are queued without blocking and carried out in the thread of
+     * the client, event identifiers are returned right away. connect(), disconnect(),
+     * isConnected(), statistics(), timeline(), latencies(), startRecording() and
+     * stopRecording() block until the client thread has handled them, rest of the functions
+     * must be called from the thread that created the client. Signals are emitted in the
+     * thread the client runs in, see startDispatcherThread().
+     *
      * \section LICENSE
      *
      * NgfClient - Qt Non-Graphic Feedback daemon client library
@@ -108,6 +121,30 @@ namespace Ngf
         Q_OBJECT
 
     public:
+        /*!
+         * Message bus used by a private connection.
+         */
+        enum BusType {
+            SystemBus,  //!< System message bus, NGF daemon's default bus.
+            SessionBus  //!< Session message bus.
+        };
+
+        /*!
+         * Identifier returned for plays suppressed by a rate limit, see setRateLimit().
+         */
+        enum { SuppressedEventId = 0xffffffffu };
+
+        /*!
+         * Dispatch class of a played event. Classes are queued separately and sent in
+         * order of priority, so that for example touch feedback isn't held up by a burst
+         * of notifications.
+         */
+        enum Priority {
+            RealtimePriority,   //!< Sent before anything else, for feedback to user input.
+            NormalPriority,     //!< Default class, sent after realtime events.
+            BackgroundPriority  //!< Sent last, and only a few at a time while others are waiting for a reply.
+        };
+
         /*!
          * Constructs new client instance.
          *
@@ -116,6 +153,88 @@ namespace Ngf
         Client(QObject *parent = 0);
         virtual ~Client();
 
+        /*!
+         * Use connection of its own for talking to NGF daemon.
+         *
+         * By default client shares the application wide system bus connection with all other
+         * users of the bus. With a private connection event requests and status signals don't
+         * queue up behind other traffic of the application. The client owns the connection and
+         * closes it when destroyed.
+         *
+         * Must be called before connect() or any play() call.
+         *
+         * \param bus Message bus to connect to.
+         * \param name Name for the connection, unique within the application.
+         * \return True if the connection was opened.
+         */
+        bool openPrivateConnection(BusType bus, const QString &name);
+
+        /*!
+         * Use connection of its own for talking to NGF daemon.
+         *
+         * \param address D-Bus address of the bus NGF daemon is on, for example
+         *                "unix:path=/run/dbus/system_bus_socket".
+         * \param name Name for the connection, unique within the application.
+         * \return True if the connection was opened.
+         */
+        bool openPrivateConnection(const QString &address, const QString &name);
+
+        /*!
+         * Talk to NGF daemon directly instead of through the message bus.
+         *
+         * NGF daemon can offer a socket for peer to peer D-Bus connections, which saves the trip
+         * through the bus daemon for every request and status signal. If the socket isn't
+         * there or connecting to it fails, the client keeps using the message bus. Should the
+         * peer connection be lost later on, the client falls back to the message bus as well.
+         *
+         * Unless given, the address is taken from NGF_PEER_ADDRESS environment variable,
+         * defaulting to "unix:path=$XDG_RUNTIME_DIR/ngfd/peer".
+         *
+         * Must be called before connect() or any play() call.
+         *
+         * \param address D-Bus address of the peer socket of NGF daemon.
+         * \return True if peer connection is in use.
+         */
+        bool openPeerConnection(const QString &address = QString());
+
+        /*!
+         * Play events within the application instead of talking to NGF daemon.
+         *
+         * Events go through the same states as with NGF daemon, after the given delays, but
+         * nothing is actually played. Useful for running without NGF daemon, and for testing
+         * and benchmarking the client itself. Setting NGF_TRANSPORT environment variable to
+         * "loopback" makes clients start in this mode.
+         *
+         * Private and peer connections can't be opened once loopback is in use.
+         *
+         * Must be called before connect() or any play() call.
+         *
+         * \param replyDelay Milliseconds from play() until the event is playing.
+         * \param statusDelay Milliseconds from pause(), resume() or stop() until the event
+         *                    changes state.
+         * \param duration Milliseconds the event plays before it completes, negative
+         *                 to play until stopped.
+         * \return True if loopback is in use.
+         */
+        bool openLoopback(int replyDelay = 0, int statusDelay = 0, int duration = -1);
+
+        /*!
+         * Run the client in a thread of its own.
+         *
+         * Normally replies and status changes from NGF daemon are handled in the thread that
+         * created the client, usually the GUI thread, and have to wait while that thread is
+         * busy. With a dispatcher thread they are handled right away, and signals are emitted
+         * in the dispatcher thread. Slots connected with Qt::AutoConnection are still called
+         * in the thread of their receiver, Qt::DirectConnection gets them called in the
+         * dispatcher thread without any delay.
+         *
+         * Private, peer and loopback connections must be opened before this, and this must
+         * be called before connect() or any play() call.
+         *
+         * \return True if the dispatcher thread is running.
+         */
+        bool startDispatcherThread();
+
         /*!
          * Connect to NGF daemon.
          *
@@ -125,10 +244,32 @@ namespace Ngf
          * If NGF daemon connection is severed after connect() is called, NGF Client makes
          * sure to reconnect to NGF daemon when it reappears.
          *
+         * Nothing is set up on the message bus until the first event is played, so connecting
+         * at startup is cheap also for applications that end up playing nothing.
+         *
+         * Once connected, events played while NGF daemon is not on the message bus are held
+         * back until it registers, and then played all at once. At most 32 events are held,
+         * each for at most 3 seconds. Events that don't fit or wait longer than that fail
+         * with eventFailed(quint32) right away.
+         *
          * \return True if connection to NGF daemon was successful.
          */
         virtual bool connect();
 
+        /*!
+         * Get ready for playing events without delaying the caller.
+         *
+         * Connects to NGF daemon like connect() does, and in addition opens the bus
+         * connection, starts following NGF daemon and checks that it's on the bus, all
+         * from the event loop. First event played after this goes out without any setup.
+         *
+         * Once NGF daemon is found signal ready() is emitted, connectionStatus(bool) tells
+         * whether it was found or not, and later on whether it leaves the bus.
+         *
+         * \param ping Also make a round trip to NGF daemon before it's considered ready.
+         */
+        void warmUp(bool ping = false);
+
         /*!
          * Get connection status to NGF daemon.
          *
@@ -151,6 +292,10 @@ namespace Ngf
          * doesn't guarantee that event will be successfully started. User needs to watch for
          * event signals for determining whether event is really started.
          *
+         * The request is sent to NGF daemon once control returns to the event loop. Event
+         * stopped before that is never sent at all, eventCompleted() is emitted for it without
+         * contacting NGF daemon.
+         *
          * \param event String name of wanted event.
          * \return 0 if no connection to NGF daemon or identifier of new event on success.
          */
@@ -165,6 +310,116 @@ namespace Ngf
          */
         virtual quint32 play(const QString &event, const QMap<QString, QVariant> &properties);
 
+        /*!
+         * Play event that is of no use unless it starts in time.
+         *
+         * Meant for feedback that goes stale quickly, like touch feedback. Event that hasn't
+         * been sent to NGF daemon by the deadline is dropped without sending it, and event
+         * whose Play request isn't answered by then is given up on. Either way eventFailed()
+         * is emitted at the deadline. Event that NGF daemon starts too late is stopped and
+         * reported failed as well.
+         *
+         * \param event String name of wanted event.
+         * \param properties Extra properties for new event in key:value pairs.
+         * \param deadline Milliseconds from this call the event must start within,
+         *                 0 for no deadline.
+         * \return 0 if no connection to NGF daemon or identifier of new event on success.
+         */
+        quint32 play(const QString &event, const QMap<QString, QVariant> &properties, int deadline);
+
+        /*!
+         * Play event in given priority class.
+         *
+         * Events played with other functions belong to NormalPriority.
+         *
+         * \param event String name of wanted event.
+         * \param properties Extra properties for new event in key:value pairs.
+         * \param priority Dispatch class of the event.
+         * \param deadline Milliseconds from this call the event must start within,
+         *                 0 for no deadline. See play(const QString &, const QMap<QString, QVariant> &, int).
+         * \return 0 if no connection to NGF daemon or identifier of new event on success.
+         */
+        quint32 play(const QString &event, const QMap<QString, QVariant> &properties,
+                     Priority priority, int deadline = 0);
+
+        /*!
+         * Play several events at once.
+         *
+         * All requests are sent to NGF daemon together. Each event is then followed like an
+         * event started with play(), and once NGF daemon has answered every request of the
+         * batch, batchFinished() is emitted.
+         *
+         * \param requests Events to play.
+         * \return Identifiers of the new events, in the same order as the requests.
+         */
+        QList<quint32> playBatch(const QList<EventRequest> &requests);
+
+        /*!
+         * Play event without following it.
+         *
+         * Meant for short feedback effects, like touch feedback, whose progress is of no interest.
+         * The request is sent without expecting a reply and the client keeps no record of the
+         * event, so no event signals are emitted for it and it can't be paused or stopped.
+         *
+         * Events played before it are sent first. Unlike played events, one shot events are
+         * not held back while NGF daemon is not on the message bus, they are dropped.
+         *
+         * \param event String name of wanted event.
+         * \return True if the request was sent to NGF daemon.
+         */
+        bool playOneShot(const QString &event);
+
+        /*!
+         * Play event without following it.
+         *
+         * \param event String name of wanted event.
+         * \param properties Extra properties for new event in key:value pairs.
+         * \return True if the request was sent to NGF daemon.
+         */
+        bool playOneShot(const QString &event, const QMap<QString, QVariant> &properties);
+
+        /*!
+         * Prepare event for playing.
+         *
+         * Builds the Play request once, so that events played often with the same properties
+         * don't pay for it on every play. Prepared event stays usable as long as the client
+         * exists.
+         *
+         * \param event String name of wanted event.
+         * \return Prepared event to be played with play(const PreparedEvent &) or
+         *         playOneShot(const PreparedEvent &).
+         */
+        PreparedEvent prepare(const QString &event);
+
+        /*!
+         * Prepare event for playing.
+         *
+         * \param event String name of wanted event.
+         * \param properties Extra properties for the event in key:value pairs.
+         * \return Prepared event to be played with play(const PreparedEvent &) or
+         *         playOneShot(const PreparedEvent &).
+         */
+        PreparedEvent prepare(const QString &event, const QMap<QString, QVariant> &properties);
+
+        /*!
+         * Play prepared event.
+         *
+         * Works like play(const QString &, const QMap<QString, QVariant> &) with the name and
+         * properties of the prepared event.
+         *
+         * \param event Event prepared with prepare().
+         * \return 0 if the prepared event is invalid or identifier of new event on success.
+         */
+        quint32 play(const PreparedEvent &event);
+
+        /*!
+         * Play prepared event without following it.
+         *
+         * \param event Event prepared with prepare().
+         * \return True if the request was sent to NGF daemon.
+         */
+        bool playOneShot(const PreparedEvent &event);
+
         /*!
          * Pause running event by id.
          *
@@ -219,6 +474,188 @@ namespace Ngf
          */
         virtual bool stop(const QString &event);
 
+        /*!
+         * Limit how often event with given name can be played.
+         *
+         * Meant for feedback triggered at input rate, like feedback for scrolling. Plays of the
+         * event are let through as long as there are tokens left, each play takes one and a
+         * new one is added every \a interval milliseconds, up to \a burst tokens. Plays that
+         * exceed the limit are suppressed before anything is sent or recorded: play() returns
+         * SuppressedEventId, playOneShot() returns false and playBatch() has SuppressedEventId
+         * in place of the event. No signals are emitted for suppressed plays, and
+         * batchFinished() lists only the events of the batch that were played.
+         *
+         * \param event Event name.
+         * \param interval Milliseconds it takes to earn one play, 0 to remove the limit.
+         * \param burst Number of plays allowed in quick succession.
+         */
+        void setRateLimit(const QString &event, int interval, int burst = 1);
+
+        /*!
+         * Get internal statistics of the client.
+         *
+         * Meant for diagnostics, new keys may be added in later versions.
+         *
+         * \li eventSlots Number of event records allocated by the client.
+         * \li eventSlotsInUse Number of event records in use, including events
+         *     that are waiting for a reply from NGF daemon.
+         * \li elidedCalls Number of Play and Stop calls that were never made because the
+         *     event was stopped before it was dispatched to NGF daemon.
+         * \li offlineQueued Number of events held back because NGF daemon was not on the
+         *     message bus.
+         * \li offlineDropped Number of held back events that failed because NGF daemon didn't
+         *     register in time, or because too many events were held back already, and of
+         *     playing events that were lost when NGF daemon left the message bus.
+         * \li deadlineDropped Number of events that failed because they didn't start by
+         *     their deadline.
+         * \li queuedCalls Number of calls made from other threads and carried out in the
+         *     thread of the client.
+         * \li suppressedCalls Number of plays suppressed by rate limits.
+         * \li stagedRealtime, stagedNormal, stagedBackground Number of events of each
+         *     priority class waiting to be sent to NGF daemon.
+         * \li stagedPeakRealtime, stagedPeakNormal, stagedPeakBackground Largest number of
+         *     events of each priority class that have been waiting at once.
+         * \li backgroundCalls Number of background events waiting for a reply.
+         * \li playsIssued Number of events played, including one shot events.
+         * \li replies Number of Play replies received from NGF daemon.
+         * \li failures Number of failed events by reason: reply for failed Play calls,
+         *     status for failures reported by NGF daemon, offline and deadline.
+         * \li completions Number of events that completed.
+         * \li eventsInFlight Number of events the client follows at the moment.
+         * \li eventsInFlightPeak Largest number of events the client has followed at once.
+         * \li pendingCalls Number of Play calls waiting for a reply.
+         * \li bytesMarshalled Approximate number of bytes of calls sent to NGF daemon.
+         * \li statusReceived Number of status changes received from NGF daemon.
+         * \li statusMatched Number of received status changes that concerned events of
+         *     this client.
+         * \li statusSubscribed Whether the client follows status changes at the moment,
+         *     which it only does while it has events.
+         *
+         * \return Statistics as key:value pairs.
+         */
+        QVariantMap statistics() const;
+
+        /*!
+         * Get statistics of the client as an object.
+         *
+         * The object has the statistics for monitoring as properties, and keeps them up
+         * to date while the client is in use. It is owned by the client, and the same
+         * object is returned on every call.
+         *
+         * Must be called from the thread that created the client, where the object lives.
+         *
+         * \return Statistics object of the client.
+         */
+        ClientStats *stats();
+
+        /*!
+         * Record calls of the client and replies from NGF daemon to a trace file.
+         *
+         * Every play, one shot play, pause, resume and stop is recorded with its
+         * properties, and so are Play replies and state changes from NGF daemon, each
+         * with a monotonic timestamp. Traces are read with TraceReader, and can be
+         * replayed with ngf-qt-client --replay.
+         *
+         * Recording to another file ends the previous trace.
+         *
+         * \param fileName Path of the trace, overwritten if it exists.
+         * \return True if recording started.
+         */
+        bool startRecording(const QString &fileName);
+
+        /*!
+         * Stop recording and close the trace file.
+         *
+         * Recording also stops by itself, with a warning, if writing the trace fails for
+         * example because the disk is full.
+         *
+         * \return False if the trace couldn't be written completely.
+         */
+        bool stopRecording();
+
+        /*!
+         * Get the recent history of the client.
+         *
+         * The client always keeps its last 512 operations and state changes in memory, at
+         * next to no cost. Meant for finding out what happened when feedback went missing
+         * or was late, without running with debug logging.
+         *
+         * One line for each, oldest first: time in microseconds on a monotonic clock
+         * started with the client, operation, client event identifier, NGF daemon event
+         * identifier and a value that depends on the operation, such as the state in
+         * status lines.
+         *
+         * The same is available over D-Bus as DumpFlightRecorder() of interface
+         * org.sailfishos.ngf.ClientDebug on the bus connection of the client, when the
+         * process is started with NGF_CLIENT_DEBUG_DBUS set.
+         *
+         * Can be called from any thread.
+         *
+         * \return History of the client as text.
+         */
+        QString dumpFlightRecorder() const;
+
+        /*!
+         * Write the history of every client in the process to standard error when
+         * the process gets a signal.
+         *
+         * Histories of up to 16 clients alive at once are written. Clients created
+         * beyond that warn about it, and the dump ends with the number of clients that
+         * were left out.
+         *
+         * \param signal Signal to install the handler for, e.g. SIGUSR2.
+         * \return True if the handler was installed.
+         * \sa dumpFlightRecorder()
+         */
+        static bool dumpFlightRecordersOnSignal(int signal);
+
+        /*!
+         * Record timelines and latencies of played events.
+         *
+         * Off by default. While on, each event is timestamped when it is played, when its
+         * Play request is sent, when NGF daemon replies and when its state changes. Timelines
+         * of the latest 256 events are kept, and the latest 128 latencies of each stage
+         * for each event name.
+         *
+         * \param enabled Whether to record events played from now on.
+         */
+        void setTimelinesEnabled(bool enabled);
+
+        /*!
+         * Get timeline of a recorded event.
+         *
+         * Times are microseconds on a monotonic clock started with the client.
+         *
+         * \li event Event name.
+         * \li played When play() was called.
+         * \li sent When Play request was sent to NGF daemon, missing if it never was.
+         * \li replied When NGF daemon replied, missing if it hasn't.
+         * \li serverEventId Identifier NGF daemon gave to the event, 0 if it failed.
+         * \li status List of state changes received from NGF daemon, each a map with
+         *     the state, 0 failed, 1 completed, 2 playing or 3 paused, and its time.
+         *
+         * \param event_id Identifier of the event.
+         * \return Timeline as key:value pairs, empty if the event wasn't recorded.
+         */
+        QVariantMap timeline(quint32 event_id) const;
+
+        /*!
+         * Get latency percentiles of recorded events.
+         *
+         * Keyed by event name, and then by stage:
+         *
+         * \li dispatch From play() to sending the Play request.
+         * \li reply From sending the Play request to the reply of NGF daemon.
+         * \li start From play() to the reply of NGF daemon.
+         * \li status From the reply, or the previous state change, to a state change.
+         *
+         * Each stage has p50, p95 and p99 in microseconds, and the number of samples they
+         * were worked out from.
+         *
+         * \return Latencies as key:value pairs.
+         */
+        QVariantMap latencies() const;
+
     signals:
 
         /*!
@@ -229,7 +666,8 @@ namespace Ngf
         void connectionStatus(bool connected);
 
         /*!
-         * Signal emitted when event playing failed.
+         * Signal emitted when event playing failed. This is also emitted for events that
+         * were playing when NGF daemon left the message bus.
          *
          * \param event_id Event identifier number.
          */
@@ -256,6 +694,20 @@ namespace Ngf
          */
         void eventPaused(quint32 event_id);
 
+        /*!
+         * Signal emitted when NGF daemon has answered all Play requests of a batch started
+         * with playBatch(). Events that failed to start are reported with eventFailed()
+         * before this.
+         *
+         * \param event_ids Event identifier numbers of the batch.
+         */
+        void batchFinished(const QList<quint32> &event_ids);
+
+        /*!
+         * Signal emitted when NGF daemon has been found after warmUp().
+         */
+        void ready();
+
     private:
         Q_DISABLE_COPY(Client)
         Q_DECLARE_PRIVATE(Client)
@@ -0,0 +1,104 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGF_CLIENTSTATS_H
+#define NGF_CLIENTSTATS_H
+
+#include <QObject>
+#include <QVariantMap>
+#include "ngfclient_global.h"
+
+namespace Ngf
+{
+    /*!
+     * \class Ngf::ClientStats ngfclientstats.h NgfClient
+     *
+     * \brief Counters and gauges of a client for monitoring
+     *
+     * Properties of the client statistics, kept up to date while anyone is interested.
+     * Values are refreshed at most a few times per second, changed() tells when. Obtained
+     * with Client::stats(), and available in QML through NonGraphicalFeedback.
+     */
+    class NGFCLIENT_EXPORT ClientStats : public QObject
+    {
+        Q_OBJECT
+        //! Number of events played, including one shot events.
+        Q_PROPERTY(qulonglong playsIssued READ playsIssued NOTIFY changed)
+        //! Number of Play replies received from NGF daemon.
+        Q_PROPERTY(qulonglong replies READ replies NOTIFY changed)
+        //! Number of events that failed, for any reason.
+        Q_PROPERTY(qulonglong failures READ failures NOTIFY changed)
+        //! Number of failed events by reason: reply, status, offline and deadline.
+        Q_PROPERTY(QVariantMap failuresByReason READ failuresByReason NOTIFY changed)
+        //! Number of events that completed.
+        Q_PROPERTY(qulonglong completions READ completions NOTIFY changed)
+        //! Number of events the client follows at the moment.
+        Q_PROPERTY(int eventsInFlight READ eventsInFlight NOTIFY changed)
+        //! Largest number of events the client has followed at once.
+        Q_PROPERTY(int eventsInFlightPeak READ eventsInFlightPeak NOTIFY changed)
+        //! Number of Play calls waiting for a reply.
+        Q_PROPERTY(int pendingCalls READ pendingCalls NOTIFY changed)
+        //! Number of status changes received from NGF daemon.
+        Q_PROPERTY(qulonglong statusReceived READ statusReceived NOTIFY changed)
+        //! Number of received status changes that concerned events of the client.
+        Q_PROPERTY(qulonglong statusMatched READ statusMatched NOTIFY changed)
+        //! Approximate number of bytes sent to NGF daemon.
+        Q_PROPERTY(qulonglong bytesMarshalled READ bytesMarshalled NOTIFY changed)
+
+    public:
+        virtual ~ClientStats();
+
+        qulonglong playsIssued() const;
+        qulonglong replies() const;
+        qulonglong failures() const;
+        QVariantMap failuresByReason() const;
+        qulonglong completions() const;
+        int eventsInFlight() const;
+        int eventsInFlightPeak() const;
+        int pendingCalls() const;
+        qulonglong statusReceived() const;
+        qulonglong statusMatched() const;
+        qulonglong bytesMarshalled() const;
+
+        /*!
+         * Update the values right away.
+         */
+        Q_INVOKABLE void refresh();
+
+    signals:
+        /*!
+         * Signal emitted when the values have been updated.
+         */
+        void changed();
+
+    private slots:
+        void update(const QVariantMap &statistics);
+
+    private:
+        friend class ClientPrivate;
+        explicit ClientStats(QObject *client);
+
+        QVariantMap m_values;
+
+        Q_DISABLE_COPY(ClientStats)
+    };
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGF_EVENTREQUEST_H
+#define NGF_EVENTREQUEST_H
+
+#include <QMap>
+#include <QString>
+#include <QVariant>
+
+namespace Ngf
+{
+    /*!
+     * \class Ngf::EventRequest ngfeventrequest.h NgfClient
+     *
+     * \brief Request to play an event
+     *
+     * Describes one event to be played with Client::playBatch().
+     */
+    class EventRequest
+    {
+    public:
+        /*!
+         * Constructs new event request.
+         *
+         * \param _event String name of wanted event.
+         * \param _properties Extra properties for new event in key:value pairs.
+         * \param _deadline Milliseconds from playBatch() the event must start within,
+         *                  0 for no deadline.
+         */
+        EventRequest(const QString &_event = QString(),
+                     const QMap<QString, QVariant> &_properties = QMap<QString, QVariant>(),
+                     int _deadline = 0)
+            : event(_event), properties(_properties), deadline(_deadline)
+        {}
+
+        //! String name of wanted event.
+        QString event;
+        //! Extra properties for new event in key:value pairs.
+        QMap<QString, QVariant> properties;
+        //! Milliseconds from playBatch() the event must start within, 0 for no deadline.
+        int deadline;
+    };
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGF_PREPAREDEVENT_H
+#define NGF_PREPAREDEVENT_H
+
+#include <QExplicitlySharedDataPointer>
+#include <QMap>
+#include <QString>
+#include <QVariant>
+#include "ngfclient_global.h"
+
+namespace Ngf
+{
+    class PreparedEventPrivate;
+
+    /*!
+     * \class Ngf::PreparedEvent ngfpreparedevent.h NgfClient
+     *
+     * \brief Event request built once and played many times
+     *
+     * Prepared event holds a ready made Play request for an event name and set of properties.
+     * It is created with Client::prepare() and can then be played any number of times with
+     * Client::play(const PreparedEvent &) without building the request again. Copying prepared
+     * events is cheap, copies share the same request.
+     */
+    class NGFCLIENT_EXPORT PreparedEvent
+    {
+    public:
+        /*!
+         * Constructs invalid prepared event.
+         */
+        PreparedEvent();
+        PreparedEvent(const PreparedEvent &other);
+        ~PreparedEvent();
+
+        PreparedEvent &operator=(const PreparedEvent &other);
+
+        /*!
+         * Check if the prepared event can be played.
+         *
+         * \return True if the event was created with Client::prepare().
+         */
+        bool isValid() const;
+
+        /*!
+         * \return String name of the event.
+         */
+        QString event() const;
+
+        /*!
+         * \return Properties of the event.
+         */
+        QMap<QString, QVariant> properties() const;
+
+    private:
+        friend class ClientPrivate;
+        PreparedEvent(PreparedEventPrivate *d);
+
+        QExplicitlySharedDataPointer<PreparedEventPrivate> d;
+    };
+}
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * NgfClient - Qt Non-Graphic Feedback daemon client library
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: juho.hamalainen@tieto.com
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1 as published by the Free Software Foundation.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef NGF_TRACE_H
+#define NGF_TRACE_H
+
+#include <QMap>
+#include <QString>
+#include <QVariant>
+#include "ngfclient_global.h"
+
+namespace Ngf
+{
+    class TraceReaderPrivate;
+
+    /*!
+     * \class Ngf::TraceRecord ngftrace.h NgfClient
+     *
+     * \brief One call or reply of a recorded client
+     *
+     * Recorded with Client::startRecording() and read back with TraceReader. Only the
+     * members that concern the type of the record are set.
+     */
+    class TraceRecord
+    {
+    public:
+        enum Type {
+            //! Event was played, with eventId, event, properties, priority and deadline.
+            Play,
+            //! One shot event was played, with event and properties.
+            PlayOneShot,
+            //! Event was paused, by eventId or by event name.
+            Pause,
+            //! Event was resumed, by eventId or by event name.
+            Resume,
+            //! Event was stopped, by eventId or by event name.
+            Stop,
+            //! NGF daemon replied to Play of eventId, with ok and serverEventId.
+            Reply,
+            //! NGF daemon sent a state change of serverEventId, eventId is 0 if it
+            //! wasn't an event of the client.
+            Status
+        };
+
+        TraceRecord()
+            : type(Play), time(0), eventId(0), priority(0), deadline(0), ok(false),
+              serverEventId(0), state(0)
+        {}
+
+        //! Type of the record.
+        Type type;
+        //! Nanoseconds on a monotonic clock started with the client.
+        qint64 time;
+        //! Client event identifier.
+        quint32 eventId;
+        //! String name of the event.
+        QString event;
+        //! Properties the event was played with.
+        QMap<QString, QVariant> properties;
+        //! Priority the event was played with, see Client::Priority.
+        int priority;
+        //! Milliseconds from play() the event had to start within, 0 for no deadline.
+        int deadline;
+        //! Whether NGF daemon started the event.
+        bool ok;
+        //! Event identifier given by NGF daemon.
+        quint32 serverEventId;
+        //! State from NGF daemon, 0 failed, 1 completed, 2 playing or 3 paused.
+        quint32 state;
+    };
+
+    /*!
+     * \class Ngf::TraceReader ngftrace.h NgfClient
+     *
+     * \brief Reads traces recorded with Client::startRecording()
+     */
+    class NGFCLIENT_EXPORT TraceReader
+    {
+    public:
+        TraceReader();
+        ~TraceReader();
+
+        /*!
+         * Open a trace file for reading.
+         *
+         * \param fileName Path of the trace.
+         * \return True if the file is a trace this version can read.
+         */
+        bool open(const QString &fileName);
+
+        /*!
+         * Read the next record.
+         *
+         * \param record Record to fill in.
+         * \return False at the end of the trace, or if the rest of it is corrupt.
+         */
+        bool next(TraceRecord *record);
+
+    private:
+        TraceReaderPrivate * const d;
+
+        Q_DISABLE_COPY(TraceReader)
+    };
+}
+
+#endif
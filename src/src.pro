@@ -12,6 +12,9 @@ CONFIG += create_pc create_prl no_install_prl
 INCLUDEPATH += include
 include(dbus/dbus.pri)
 
+# Static tracepoints for perf and SystemTap, needs sys/sdt.h from systemtap-sdt-devel
+ngf_tracepoints: DEFINES += NGF_TRACEPOINTS
+
 target.path = $$[QT_INSTALL_LIBS]
 headers.path = $$PREFIX/include/ngf-qt$${QT_MAJOR_VERSION}
 headers.files = include/*
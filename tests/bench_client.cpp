@@ -0,0 +1,649 @@
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QLibraryInfo>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QPluginLoader>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+#include <QtQml/QQmlComponent>
+#include <QtQml/QQmlEngine>
+#include <QtQml/QQmlProperty>
+#include <qfeedbackplugininterfaces.h>
+
+#include "ngfclient.h"
+#include "clientprivate.h"
+#include "transport.h"
+
+#include "testbase.h"
+#include "moc_testbase.cpp"
+
+namespace Ngf {
+namespace Tests {
+
+class BenchClient : public TestBase
+{
+    Q_OBJECT
+
+    enum {
+        POPULATE_CHUNK = 1000, // Stay well below the bus daemon's pending reply limit
+        POPULATE_TIMEOUT = 60000, // [ms]
+        BUSY_FRAME = 16, // [ms]
+        BUSY_ROUNDS = 50,
+        THROUGHPUT_PLAYS = 1000,
+    };
+
+    // Keep in sync with DeclarativeNgfEvent::EventStatus
+    enum EventStatus {
+        Stopped,
+        Failed,
+        Playing,
+        Paused
+    };
+
+public:
+    BenchClient();
+
+private slots:
+    void initTestCase();
+
+    void benchStatusDispatch_data();
+    void benchStatusDispatch();
+    void benchPlayCall_data();
+    void benchPlayCall();
+    void benchPlayLatency_data();
+    void benchPlayLatency();
+    void benchPlayThroughput_data();
+    void benchPlayThroughput();
+    void benchPauseResume_data();
+    void benchPauseResume();
+    void benchWrapperLatency_data();
+    void benchWrapperLatency();
+    void benchWrapperOneShot_data();
+    void benchWrapperOneShot();
+    void benchLoopbackCycle_data();
+    void benchLoopbackCycle();
+    void benchBusyThreadLatency_data();
+    void benchBusyThreadLatency();
+    void benchStartup_data();
+    void benchStartup();
+    void benchFeedbackPluginLoad();
+
+private:
+    static ClientPrivate *clientPrivate(Client *client);
+    static QString feedbackPluginPath();
+    static QObject *createFeedbackItem(QQmlEngine *engine, const QString &event);
+    static bool populate(Client *client, const QString &prefix, int count);
+    static bool unpopulate(Client *client, const QString &prefix, int count);
+};
+
+} // namespace Tests
+} // namespace Ngf
+
+using namespace Ngf::Tests;
+
+/*
+ * \class Ngf::Tests::BenchClient
+ *
+ * Results are meant to be tracked across releases, run with e.g.
+ * "-o bench_client.xml,xml" to have them in machine readable form. Rows
+ * are named after what they measure, keep them stable.
+ */
+
+BenchClient::BenchClient()
+{
+}
+
+void BenchClient::initTestCase()
+{
+    QVERIFY(waitForService(service()));
+}
+
+void BenchClient::benchStatusDispatch_data()
+{
+    QTest::addColumn<int>("liveEvents");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void BenchClient::benchStatusDispatch()
+{
+    QFETCH(int, liveEvents);
+
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    Client client;
+    QVERIFY(client.connect());
+
+    const QString prefix = QString("status-dispatch-%1-").arg(liveEvents);
+    QVERIFY(populate(&client, prefix, liveEvents));
+
+    // The most recently started event is the worst case for a linear scan
+    QDBusReply<quint32> lastId = mockService.call("mock_id", prefix + QString::number(liveEvents - 1));
+    QVERIFY(lastId.isValid());
+    QVERIFY(lastId.value() > 0);
+
+    ClientPrivate *d = clientPrivate(&client);
+    QVERIFY(d);
+
+    const QMetaObject *mo = d->metaObject();
+    const QMetaMethod setEventState = mo->method(mo->indexOfSlot("setEventState(quint32,quint32)"));
+    QVERIFY(setEventState.isValid());
+
+    QBENCHMARK {
+        setEventState.invoke(d, Qt::DirectConnection,
+                Q_ARG(quint32, lastId.value()),
+                Q_ARG(quint32, quint32(StatusEventPlaying)));
+    }
+
+    QVERIFY(unpopulate(&client, prefix, liveEvents));
+}
+
+void BenchClient::benchPlayCall_data()
+{
+    QTest::addColumn<bool>("withProperties");
+
+    QTest::newRow("plain") << false;
+    QTest::newRow("properties") << true;
+}
+
+void BenchClient::benchPlayCall()
+{
+    QFETCH(bool, withProperties);
+
+    Client client;
+    QVERIFY(client.connect());
+
+    QVariantMap properties;
+    if (withProperties) {
+        properties.insert("media.audio", true);
+        properties.insert("sound.volume", 80);
+        properties.insert("sound.filename", "/usr/share/sounds/an-event.wav");
+    }
+
+    QList<quint32> ids;
+
+    // What the caller of play() pays, the call itself is made later from the event loop
+    QBENCHMARK {
+        ids.append(client.play("play-call", properties));
+    }
+
+    // Stopped before being dispatched, nothing reaches the bus
+    foreach (quint32 id, ids) {
+        client.stop(id);
+    }
+    QCOMPARE(client.statistics().value("eventSlotsInUse").toInt(), 0);
+}
+
+void BenchClient::benchPlayLatency_data()
+{
+    QTest::addColumn<bool>("peer");
+
+    QTest::newRow("bus") << false;
+    QTest::newRow("peer") << true;
+}
+
+void BenchClient::benchPlayLatency()
+{
+    QFETCH(bool, peer);
+
+    Client client;
+    if (peer) {
+        QVERIFY(client.openPeerConnection(peerAddress()));
+    }
+    QVERIFY(client.connect());
+
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    const QString prefix = QString("play-latency-%1-").arg(peer ? "peer" : "bus");
+    int i = 0;
+
+    // From play() to eventPlaying(), stopping is asynchronous and cheap compared to that
+    QBENCHMARK {
+        eventPlayingSpy.clear();
+        quint32 id = client.play(prefix + QString::number(i++));
+        while (eventPlayingSpy.isEmpty()) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+        QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), id);
+        client.stop(id);
+    }
+}
+
+void BenchClient::benchPlayThroughput_data()
+{
+    QTest::addColumn<bool>("peer");
+
+    QTest::newRow("bus") << false;
+    QTest::newRow("peer") << true;
+}
+
+void BenchClient::benchPlayThroughput()
+{
+    QFETCH(bool, peer);
+
+    Client client;
+    if (peer) {
+        QVERIFY(client.openPeerConnection(peerAddress()));
+    }
+    QVERIFY(client.connect());
+
+    int playing = 0;
+    QObject::connect(&client, &Client::eventPlaying, [&playing]() { ++playing; });
+
+    const QString prefix = QString("play-throughput-%1-").arg(peer ? "peer" : "bus");
+    QList<quint32> ids;
+    ids.reserve(THROUGHPUT_PLAYS);
+    int round = 0;
+
+    // Until all of THROUGHPUT_PLAYS events are playing, plays per second is
+    // THROUGHPUT_PLAYS divided by the result
+    QBENCHMARK {
+        playing = 0;
+        ids.clear();
+
+        for (int i = 0; i < THROUGHPUT_PLAYS; ++i) {
+            ids.append(client.play(prefix + QString("%1-%2").arg(round).arg(i)));
+        }
+        while (playing < THROUGHPUT_PLAYS) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+
+        foreach (quint32 id, ids) {
+            client.stop(id);
+        }
+        ++round;
+    }
+}
+
+void BenchClient::benchPauseResume_data()
+{
+    QTest::addColumn<int>("liveEvents");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("100") << 100;
+}
+
+void BenchClient::benchPauseResume()
+{
+    QFETCH(int, liveEvents);
+
+    Client client;
+    QVERIFY(client.connect());
+
+    const QString prefix = QString("pause-resume-%1-").arg(liveEvents);
+    QVERIFY(populate(&client, prefix, liveEvents));
+
+    int paused = 0;
+    int playing = 0;
+    QObject::connect(&client, &Client::eventPaused, [&paused]() { ++paused; });
+    QObject::connect(&client, &Client::eventPlaying, [&playing]() { ++playing; });
+
+    // Pause every event and resume it again, until NGFD has confirmed both
+    QBENCHMARK {
+        paused = 0;
+        playing = 0;
+
+        for (int i = 0; i < liveEvents; ++i) {
+            QVERIFY(client.pause(prefix + QString::number(i)));
+        }
+        while (paused < liveEvents) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+
+        for (int i = 0; i < liveEvents; ++i) {
+            QVERIFY(client.resume(prefix + QString::number(i)));
+        }
+        while (playing < liveEvents) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+    }
+
+    QVERIFY(unpopulate(&client, prefix, liveEvents));
+}
+
+void BenchClient::benchWrapperLatency_data()
+{
+    QTest::addColumn<bool>("qml");
+
+    QTest::newRow("client") << false;
+    QTest::newRow("qml") << true;
+}
+
+void BenchClient::benchWrapperLatency()
+{
+    QFETCH(bool, qml);
+
+    // Same measurement as benchPlayLatency, through NonGraphicalFeedback for comparison
+    if (!qml) {
+        Client client;
+        QVERIFY(client.connect());
+
+        SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+
+        QBENCHMARK {
+            eventPlayingSpy.clear();
+            quint32 id = client.play("wrapper-latency-client");
+            while (eventPlayingSpy.isEmpty()) {
+                QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+            }
+            client.stop(id);
+        }
+        return;
+    }
+
+    QQmlEngine engine;
+    QScopedPointer<QObject> item(createFeedbackItem(&engine, "wrapper-latency-qml"));
+    QVERIFY(item);
+    QQmlProperty status(item.data(), "status");
+
+    QBENCHMARK {
+        QVERIFY(QMetaObject::invokeMethod(item.data(), "play"));
+        while (status.read().toInt() != Playing) {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+        // Status goes back to Stopped right away
+        QVERIFY(QMetaObject::invokeMethod(item.data(), "stop"));
+    }
+}
+
+void BenchClient::benchWrapperOneShot_data()
+{
+    QTest::addColumn<bool>("feedback");
+
+    QTest::newRow("client") << false;
+    QTest::newRow("feedback") << true;
+}
+
+void BenchClient::benchWrapperOneShot()
+{
+    QFETCH(bool, feedback);
+
+    // Press effects of QtFeedback are one shot events played from a prepared event
+    if (!feedback) {
+        Client client;
+        QVERIFY(client.connect());
+
+        PreparedEvent press = client.prepare("feedback_press");
+
+        QBENCHMARK {
+            QVERIFY(client.playOneShot(press));
+        }
+        return;
+    }
+
+    const QString path = feedbackPluginPath();
+    if (path.isEmpty()) {
+        QSKIP("QtFeedback plugin not found");
+    }
+
+    QPluginLoader loader(path);
+    QVERIFY2(loader.load(), qPrintable(loader.errorString()));
+    QFeedbackThemeInterface *theme = qobject_cast<QFeedbackThemeInterface *>(loader.instance());
+    QVERIFY(theme);
+
+    QBENCHMARK {
+        QVERIFY(theme->play(QFeedbackEffect::Press));
+    }
+
+    QVERIFY(loader.unload());
+}
+
+void BenchClient::benchLoopbackCycle_data()
+{
+    QTest::addColumn<int>("events");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("1k") << 1000;
+}
+
+void BenchClient::benchLoopbackCycle()
+{
+    QFETCH(int, events);
+
+    Client client;
+    QVERIFY(client.openLoopback());
+    QVERIFY(client.connect());
+
+    int playing = 0;
+    int completed = 0;
+    QObject::connect(&client, &Client::eventPlaying, [&playing]() { ++playing; });
+    QObject::connect(&client, &Client::eventCompleted, [&completed]() { ++completed; });
+
+    QList<quint32> ids;
+    ids.reserve(events);
+
+    // Whole play, playing, stop, completed round of the client state machine, no bus involved
+    QBENCHMARK {
+        ids.clear();
+        playing = 0;
+        completed = 0;
+
+        for (int i = 0; i < events; ++i) {
+            ids.append(client.play("loopback-cycle"));
+        }
+        while (playing < events) {
+            QCoreApplication::processEvents();
+        }
+
+        foreach (quint32 id, ids) {
+            client.stop(id);
+        }
+        while (completed < events) {
+            QCoreApplication::processEvents();
+        }
+    }
+}
+
+void BenchClient::benchBusyThreadLatency_data()
+{
+    QTest::addColumn<bool>("dispatcher");
+
+    QTest::newRow("client-thread") << false;
+    QTest::newRow("dispatcher-thread") << true;
+}
+
+void BenchClient::benchBusyThreadLatency()
+{
+    QFETCH(bool, dispatcher);
+
+    Client client;
+    if (dispatcher) {
+        QVERIFY(client.startDispatcherThread());
+    }
+    QVERIFY(client.connect());
+
+    // Keep this thread rendering long frames, like a busy GUI thread would
+    QTimer frames;
+    QObject::connect(&frames, &QTimer::timeout, []() {
+        QElapsedTimer frame;
+        frame.start();
+        while (!frame.hasExpired(BUSY_FRAME)) {
+        }
+    });
+    frames.start(0);
+
+    QElapsedTimer clock;
+    clock.start();
+    QAtomicInteger<qint64> playingAt(-1);
+
+    // Called in whichever thread handles the Play reply
+    QObject::connect(&client, &Client::eventPlaying, [&clock, &playingAt]() {
+        playingAt.storeRelease(clock.nsecsElapsed());
+    });
+
+    const QString prefix = QString("busy-latency-%1-").arg(dispatcher ? "dispatcher" : "client");
+    qint64 total = 0;
+
+    // From play() to eventPlaying()
+    for (int i = 0; i < BUSY_ROUNDS; ++i) {
+        playingAt.storeRelease(-1);
+        const qint64 start = clock.nsecsElapsed();
+        quint32 id = client.play(prefix + QString::number(i));
+        while (playingAt.loadAcquire() < 0) {
+            QVERIFY(clock.nsecsElapsed() - start < qint64(POPULATE_TIMEOUT) * 1000000);
+            QCoreApplication::processEvents();
+        }
+        total += playingAt.loadAcquire() - start;
+        client.stop(id);
+    }
+
+    frames.stop();
+
+    QTest::setBenchmarkResult(qreal(total) / BUSY_ROUNDS / 1000000, QTest::WalltimeMilliseconds);
+}
+
+void BenchClient::benchStartup_data()
+{
+    QTest::addColumn<bool>("firstPlay");
+
+    QTest::newRow("connect") << false;
+    QTest::newRow("first-play") << true;
+}
+
+void BenchClient::benchStartup()
+{
+    QFETCH(bool, firstPlay);
+
+    const QString prefix = QString("startup-%1-").arg(firstPlay ? "first-play" : "connect");
+    int i = 0;
+
+    // What an application pays for a client at startup, and until its first event is playing
+    QBENCHMARK {
+        Client client;
+        QVERIFY(client.connect());
+
+        if (firstPlay) {
+            SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+            quint32 id = client.play(prefix + QString::number(i++));
+            while (eventPlayingSpy.isEmpty()) {
+                QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+            }
+            client.stop(id);
+        }
+    }
+}
+
+void BenchClient::benchFeedbackPluginLoad()
+{
+    const QString path = feedbackPluginPath();
+    if (path.isEmpty()) {
+        QSKIP("QtFeedback plugin not found");
+    }
+
+    QPluginLoader loader(path);
+
+    // Plugin creates its client when it's loaded, applications load it whether they
+    // give feedback or not
+    QBENCHMARK {
+        QVERIFY2(loader.load(), qPrintable(loader.errorString()));
+        QVERIFY(loader.instance());
+        QVERIFY(loader.unload());
+    }
+}
+
+QString BenchClient::feedbackPluginPath()
+{
+    const QString name = "libqtfeedback_libngf.so";
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const QString pluginsPath = QLibraryInfo::path(QLibraryInfo::PluginsPath);
+#else
+    const QString pluginsPath = QLibraryInfo::location(QLibraryInfo::PluginsPath);
+#endif
+    const QStringList candidates = QStringList()
+        << QCoreApplication::applicationDirPath() + "/../feedback/" + name
+        << pluginsPath + "/feedback/" + name;
+
+    foreach (const QString &candidate, candidates) {
+        if (QFile::exists(candidate)) {
+            return QDir::cleanPath(candidate);
+        }
+    }
+
+    return QString();
+}
+
+QObject *BenchClient::createFeedbackItem(QQmlEngine *engine, const QString &event)
+{
+    QQmlComponent component(engine);
+    component.setData(
+        "import Nemo.Ngf 1.0\n"
+        "NonGraphicalFeedback { }",
+        QUrl("file:///dev/null"));
+    if (!component.isReady()) {
+        qWarning() << "Component is not ready:" << component.errors();
+        return 0;
+    }
+
+    QObject *item = component.create();
+    if (item) {
+        QQmlProperty::write(item, "event", event);
+    }
+
+    return item;
+}
+
+ClientPrivate *BenchClient::clientPrivate(Client *client)
+{
+    return client->findChild<ClientPrivate *>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+bool BenchClient::populate(Client *client, const QString &prefix, int count)
+{
+    SignalSpy eventPlayingSpy(client, SIGNAL(eventPlaying(quint32)));
+
+    for (int i = 0; i < count; i += POPULATE_CHUNK) {
+        const int chunkEnd = qMin(i + POPULATE_CHUNK, count);
+
+        for (int j = i; j < chunkEnd; ++j) {
+            if (client->play(prefix + QString::number(j)) == 0) {
+                return false;
+            }
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        while (eventPlayingSpy.count() < chunkEnd) {
+            if (timer.hasExpired(POPULATE_TIMEOUT)) {
+                return false;
+            }
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+        }
+    }
+
+    return true;
+}
+
+// Events left playing in the mock would slow down the rows and benchmarks after
+bool BenchClient::unpopulate(Client *client, const QString &prefix, int count)
+{
+    SignalSpy eventCompletedSpy(client, SIGNAL(eventCompleted(quint32)));
+
+    for (int i = 0; i < count; i += POPULATE_CHUNK) {
+        const int chunkEnd = qMin(i + POPULATE_CHUNK, count);
+
+        for (int j = i; j < chunkEnd; ++j) {
+            if (!client->stop(prefix + QString::number(j))) {
+                return false;
+            }
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        while (eventCompletedSpy.count() < chunkEnd) {
+            if (timer.hasExpired(POPULATE_TIMEOUT)) {
+                return false;
+            }
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+        }
+    }
+
+    return true;
+}
+
+TEST_MAIN(BenchClient)
+
+#include "bench_client.moc"
@@ -0,0 +1,17 @@
+include(testapplication.pri)
+
+QT += qml
+CONFIG += link_pkgconfig
+PKGCONFIG += Qt$${QT_MAJOR_VERSION}Feedback
+
+INCLUDEPATH += ../src/dbus
+
+# Results are written to bench_client.xml as well, for tracking them across releases
+check.commands = '\
+    cd "$${OUT_PWD}" \
+    && mkdir -p ../declarative/Nemo \
+    && ln -sfn ../.. ../declarative/Nemo/Ngf \
+    && cp $${PWD}/../declarative/qmldir ../declarative \
+    && export QML_IMPORT_PATH="$${OUT_PWD}/../declarative/" \
+    && export LD_LIBRARY_PATH="$${OUT_PWD}/../src:\$\${LD_LIBRARY_PATH}" \
+    && dbus-launch ./$${TARGET} -o bench_client.xml,xml -o -,txt'
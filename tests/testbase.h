@@ -1,6 +1,8 @@
 #ifndef TESTBASE_H
 #define TESTBASE_H
 
+#include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QObject>
 #include <QtCore/QMetaProperty>
 #include <QtCore/QObject>
@@ -8,7 +10,9 @@
 #include <QtCore/QProcess>
 #include <QtCore/QTimer>
 #include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusContext>
 #include <QtDBus/QDBusInterface>
+#include <QtDBus/QDBusServer>
 #include <QtDBus/QDBusConnectionInterface>
 #include <QtDBus/QDBusServiceWatcher>
 #include <QtTest/QSignalSpy>
@@ -44,6 +48,7 @@ protected:
     static QString service() { return "com.nokia.NonGraphicFeedback1.Backend"; }
     static QString path() { return "/com/nokia/NonGraphicFeedback1"; }
     static QString interface() { return "com.nokia.NonGraphicFeedback1"; }
+    static QString peerAddress() { return QString::fromLocal8Bit(qgetenv("NGF_PEER_ADDRESS")); }
     static QByteArray notifySignal(const QObject &object, const char *property);
     static bool waitForSignal(QObject *object, const char *signal);
     static bool waitForSignal(SignalSpy *signalSpy);
@@ -62,7 +67,7 @@ protected:
     static QVariantMap alternateClientProperties();
 };
 
-class TestBase::NgfdMock : public QObject
+class TestBase::NgfdMock : public QObject, protected QDBusContext
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "com.nokia.NonGraphicFeedback1")
@@ -92,6 +97,9 @@ public:
     Q_SCRIPTABLE void mock_fail(const QString &event, const QDBusMessage &message);
     Q_SCRIPTABLE void mock_failNextPlay();
     Q_SCRIPTABLE void mock_disconnectForAWhile(const QDBusMessage &message);
+    // Only reachable by the unique name while unregistered
+    Q_SCRIPTABLE void mock_unregister(const QDBusMessage &message);
+    Q_SCRIPTABLE void mock_register();
 
     static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message);
     static void installMsgHandler();
@@ -104,7 +112,11 @@ signals:
     Q_SCRIPTABLE void mock_pauseCalled(quint32 event, bool pause);
     Q_SCRIPTABLE void mock_stopCalled(quint32 event);
 
+private slots:
+    void peerConnected(const QDBusConnection &connection);
+
 private:
+    QDBusServer *m_peerServer;
     int m_maxId;
     bool m_failNextPlay;
     QMap<QString, QPair<quint32, QVariantMap> > m_events;
@@ -359,9 +371,22 @@ inline QVariantMap TestBase::alternateClientProperties()
  */
 
 inline TestBase::NgfdMock::NgfdMock()
-    : m_maxId(0),
+    : m_peerServer(0),
+      m_maxId(0),
       m_failNextPlay(false)
 {
+    // Serve peer to peer connections as well, requests may arrive either way
+    if (!peerAddress().isEmpty()) {
+        QFile::remove(peerAddress().section('=', 1));
+        m_peerServer = new QDBusServer(peerAddress(), this);
+        if (!m_peerServer->isConnected()) {
+            qFatal("Failed to listen for peer connections at '%s': '%s'",
+                    qPrintable(peerAddress()), qPrintable(m_peerServer->lastError().message()));
+        }
+        connect(m_peerServer, SIGNAL(newConnection(QDBusConnection)),
+                this, SLOT(peerConnected(QDBusConnection)));
+    }
+
     if (!bus().registerObject(path(), this, QDBusConnection::ExportScriptableContents)) {
         qFatal("Failed to register mock D-Bus object at path '%s': '%s'",
                 qPrintable(path()), qPrintable(bus().lastError().message()));
@@ -381,7 +406,7 @@ inline quint32 TestBase::NgfdMock::Play(const QString &event, const QVariantMap
     if (m_failNextPlay) {
         m_failNextPlay = false;
 
-        bus().send(message.createErrorReply(QDBusError::InvalidArgs, "mock_failNextPlay-requested"));
+        connection().send(message.createErrorReply(QDBusError::InvalidArgs, "mock_failNextPlay-requested"));
 
         emit mock_playCalled(event, properties);
 
@@ -393,7 +418,7 @@ inline quint32 TestBase::NgfdMock::Play(const QString &event, const QVariantMap
     m_events[event] = qMakePair(id, properties);
     m_eventId2Name[id] = event;
 
-    bus().send(message.createReply(id));
+    connection().send(message.createReply(id));
 
     emit mock_playCalled(event, properties);
 
@@ -403,11 +428,11 @@ inline quint32 TestBase::NgfdMock::Play(const QString &event, const QVariantMap
 inline void TestBase::NgfdMock::Pause(quint32 event, bool pause, const QDBusMessage &message)
 {
     if (!m_eventId2Name.contains(event)) {
-        bus().send(message.createErrorReply(QDBusError::InvalidArgs, "Unknown event"));
+        connection().send(message.createErrorReply(QDBusError::InvalidArgs, "Unknown event"));
         return;
     }
 
-    bus().send(message.createReply());
+    connection().send(message.createReply());
 
     if (pause) {
         m_paused.insert(m_eventId2Name.value(event));
@@ -423,11 +448,11 @@ inline void TestBase::NgfdMock::Pause(quint32 event, bool pause, const QDBusMess
 inline void TestBase::NgfdMock::Stop(quint32 event, const QDBusMessage &message)
 {
     if (!m_eventId2Name.contains(event)) {
-        bus().send(message.createErrorReply(QDBusError::InvalidArgs, "Unknown event"));
+        connection().send(message.createErrorReply(QDBusError::InvalidArgs, "Unknown event"));
         return;
     }
 
-    bus().send(message.createReply());
+    connection().send(message.createReply());
 
     m_paused.remove(m_eventId2Name.value(event));
     m_events.remove(m_eventId2Name.value(event));
@@ -437,6 +462,16 @@ inline void TestBase::NgfdMock::Stop(quint32 event, const QDBusMessage &message)
     emit mock_stopCalled(event);
 }
 
+inline void TestBase::NgfdMock::peerConnected(const QDBusConnection &connection)
+{
+    QDBusConnection peer(connection);
+
+    if (!peer.registerObject(path(), this, QDBusConnection::ExportScriptableContents)) {
+        qFatal("Failed to register mock D-Bus object at path '%s' for peer: '%s'",
+                qPrintable(path()), qPrintable(peer.lastError().message()));
+    }
+}
+
 inline void TestBase::NgfdMock::messageHandler(QtMsgType type, const QMessageLogContext &context,
     const QString &message)
 {
@@ -521,11 +556,34 @@ inline void TestBase::NgfdMock::mock_disconnectForAWhile(const QDBusMessage &mes
     }
 }
 
+inline void TestBase::NgfdMock::mock_unregister(const QDBusMessage &message)
+{
+    bus().send(message.createReply());
+
+    if (!bus().unregisterService(service())) {
+        qFatal("Failed to unregister mock D-Bus service '%s': '%s'",
+            qPrintable(service()), qPrintable(bus().lastError().message()));
+    }
+}
+
+inline void TestBase::NgfdMock::mock_register()
+{
+    if (!bus().registerService(service())) {
+        qFatal("Failed to register mock D-Bus service: '%s' '%s'",
+            qPrintable(service()), qPrintable(bus().lastError().message()));
+    }
+}
+
 #define TEST_MAIN(TestClass)                                                \
     int main(int argc, char *argv[])                                        \
     {                                                                       \
         qputenv("DBUS_SYSTEM_BUS_ADDRESS",                                  \
                 qgetenv("DBUS_SESSION_BUS_ADDRESS"));                       \
+        if (!qEnvironmentVariableIsSet("NGF_PEER_ADDRESS")) {               \
+            qputenv("NGF_PEER_ADDRESS", QString("unix:path=%1/ngf-qt-%2")   \
+                    .arg(QDir::tempPath())                                  \
+                    .arg(QCoreApplication::applicationPid()).toLocal8Bit());\
+        }                                                                   \
                                                                             \
         if (argc == 2 && argv[1] == QLatin1String("--mock")) {              \
             Ngf::Tests::TestBase::NgfdMock::installMsgHandler();            \
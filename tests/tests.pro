@@ -4,6 +4,7 @@ TEMPLATE = subdirs
 SUBDIRS = \
         ut_client.pro \
         ut_declarativengfevent.pro \
+        bench_client.pro \
 
 configure($${PWD}/tests.xml.in)
 tests_xml.path = $${INSTALL_TESTDIR}
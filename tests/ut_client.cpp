@@ -1,4 +1,8 @@
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
 #include <QtCore/QPointer>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
 #include <QtDBus/QDBusPendingCallWatcher>
 #include <QtDBus/QDBusReply>
 
@@ -14,6 +18,13 @@ class UtClient : public TestBase
 {
     Q_OBJECT
 
+    enum {
+        THREADED_EVENTS = 100,
+        OFFLINE_QUEUE_LIMIT = 32,       // Kept in sync with ClientPrivate::ParkedLimit
+        OFFLINE_QUEUE_TIMEOUT = 3000,   // [ms] ClientPrivate::ParkedTimeout
+        FLIGHT_RECORDER_CAPACITY = 512, // FlightRecorder::Capacity
+    };
+
 public:
     UtClient();
 
@@ -28,11 +39,59 @@ private slots:
     void testPlayFail();
     void testConnectionStatus();
     void testFastPlayStop();
+    void testPlayOneShot();
+    void testElidedPlayStop();
+    void testPlayPrepared();
+    void testPlayBatch();
+    void testPrivateConnection();
+    void testPeerConnection();
+    void testLoopback();
+    void testPlayFromThreads();
+    void testDispatcherThread();
+    void testStatusSubscription();
+    void testWarmUp();
+    void testOfflineQueue();
+    void testServiceLost();
+    void testDeadlines();
+    void testRateLimit();
+    void testPriorities();
+    void testTimelines();
+    void testClientStats();
+    void testRecording();
+    void testFlightRecorder();
+    void testEventSlotReuse();
 
 private:
     QPointer<Client> m_client;
 };
 
+// Plays and stops events from a thread of its own
+class PlayerThread : public QThread
+{
+public:
+    PlayerThread(Client *client, const QString &prefix, int count)
+        : m_client(client), m_prefix(prefix), m_count(count)
+    {
+    }
+
+    QList<quint32> ids;
+
+protected:
+    void run()
+    {
+        for (int i = 0; i < m_count; ++i) {
+            quint32 id = m_client->play(m_prefix + QString::number(i));
+            ids.append(id);
+            m_client->stop(id);
+        }
+    }
+
+private:
+    Client *m_client;
+    QString m_prefix;
+    int m_count;
+};
+
 } // namespace Tests
 } // namespace Ngf
 
@@ -216,7 +275,6 @@ void UtClient::testPlayFail()
 
 void UtClient::testConnectionStatus()
 {
-    QSKIP("Libngf-qt not currently tracking the daemon availability");
     QDBusInterface mockService(service(), path(), interface(), bus());
 
     SignalSpy connectionStatusSpy(m_client, SIGNAL(connectionStatus(bool)));
@@ -238,14 +296,17 @@ void UtClient::testFastPlayStop()
 {
     QDBusInterface mockService(service(), path(), interface(), bus());
 
+    SignalSpy eventPlayingSpy(m_client, SIGNAL(eventPlaying(quint32)));
     SignalSpy eventCompletedSpy(m_client, SIGNAL(eventCompleted(quint32)));
 
     QVariantMap properties;
     properties["foo"] = "fooval";
     properties["bar"] = 42;
 
+    // Stopped right after NGFD has answered, stopping before dispatch is testElidedPlayStop
     quint32 id = m_client->play("an-event", properties);
     QVERIFY(id > 0);
+    QVERIFY(waitForSignal(&eventPlayingSpy));
     QVERIFY(m_client->stop("an-event"));
 
     QVERIFY(waitForSignal(&eventCompletedSpy));
@@ -253,6 +314,905 @@ void UtClient::testFastPlayStop()
     QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), 4u);
 }
 
+void UtClient::testPlayOneShot()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+    SignalSpy eventPlayingSpy(m_client, SIGNAL(eventPlaying(quint32)));
+
+    QVariantMap properties;
+    properties["foo"] = "fooval";
+
+    QVERIFY(m_client->playOneShot("a-one-shot-event", properties));
+
+    QVERIFY(waitForSignal(&playCalledSpy));
+    QCOMPARE(playCalledSpy.count(), 1);
+    QCOMPARE(playCalledSpy.at(0).at(0).toString(), QString("a-one-shot-event"));
+    QCOMPARE(playCalledSpy.at(0).at(1).toMap(), properties);
+
+    // Client doesn't follow the event at all
+    QCOMPARE(m_client->statistics().value("eventSlotsInUse").toInt(), 0);
+    QVERIFY(mockService.call("mock_stop", "a-one-shot-event").type() == QDBusMessage::ReplyMessage);
+    QCOMPARE(eventPlayingSpy.count(), 0);
+
+    // Events played before a one shot event reach NGFD first
+    SignalSpy eventCompletedSpy(m_client, SIGNAL(eventCompleted(quint32)));
+    quint32 id = m_client->play("an-event-before-one-shot");
+    QVERIFY(m_client->playOneShot("a-one-shot-event-after"));
+
+    QTRY_COMPARE(playCalledSpy.count(), 3);
+    QCOMPARE(playCalledSpy.at(1).at(0).toString(), QString("an-event-before-one-shot"));
+    QCOMPARE(playCalledSpy.at(2).at(0).toString(), QString("a-one-shot-event-after"));
+
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QVERIFY(m_client->stop(id));
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QVERIFY(mockService.call("mock_stop", "a-one-shot-event-after").type() == QDBusMessage::ReplyMessage);
+}
+
+void UtClient::testElidedPlayStop()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+    SignalSpy eventCompletedSpy(m_client, SIGNAL(eventCompleted(quint32)));
+
+    const quint64 elidedCalls = m_client->statistics().value("elidedCalls").toULongLong();
+
+    quint32 id = m_client->play("an-event");
+    QVERIFY(id > 0);
+    QVERIFY(m_client->stop(id));
+
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QCOMPARE(eventCompletedSpy.count(), 1);
+    QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), id);
+    QCOMPARE(playCalledSpy.count(), 0);
+    QCOMPARE(m_client->statistics().value("elidedCalls").toULongLong(), elidedCalls + 2);
+}
+
+void UtClient::testPlayPrepared()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+    SignalSpy eventPlayingSpy(m_client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventCompletedSpy(m_client, SIGNAL(eventCompleted(quint32)));
+
+    QVariantMap properties;
+    properties["foo"] = "fooval";
+    properties["bar"] = 42;
+
+    QVERIFY(!PreparedEvent().isValid());
+    QCOMPARE(m_client->play(PreparedEvent()), 0u);
+
+    PreparedEvent prepared = m_client->prepare("a-prepared-event", properties);
+    QVERIFY(prepared.isValid());
+    QCOMPARE(prepared.event(), QString("a-prepared-event"));
+    QCOMPARE(prepared.properties(), properties);
+
+    for (int i = 0; i < 2; ++i) {
+        quint32 id = m_client->play(prepared);
+        QVERIFY(id > 0);
+
+        QVERIFY(waitForSignals(SignalSpyList() << &playCalledSpy << &eventPlayingSpy));
+        QCOMPARE(playCalledSpy.count(), 1);
+        QCOMPARE(playCalledSpy.at(0).at(0).toString(), QString("a-prepared-event"));
+        QCOMPARE(playCalledSpy.at(0).at(1).toMap(), properties);
+        QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), id);
+
+        QVERIFY(m_client->stop(id));
+
+        QVERIFY(waitForSignal(&eventCompletedSpy));
+        QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), id);
+
+        playCalledSpy.clear();
+        eventPlayingSpy.clear();
+        eventCompletedSpy.clear();
+    }
+}
+
+void UtClient::testPlayBatch()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+    SignalSpy eventPlayingSpy(m_client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy batchFinishedSpy(m_client, SIGNAL(batchFinished(QList<quint32>)));
+
+    QVariantMap properties;
+    properties["foo"] = "fooval";
+
+    QList<EventRequest> requests;
+    requests << EventRequest("a-batch-event-1")
+             << EventRequest("a-batch-event-2", properties)
+             << EventRequest("a-batch-event-3");
+
+    QList<quint32> ids = m_client->playBatch(requests);
+    QCOMPARE(ids.count(), 3);
+    QVERIFY(ids.at(0) > 0);
+    QCOMPARE(ids.at(1), ids.at(0) + 1);
+    QCOMPARE(ids.at(2), ids.at(0) + 2);
+
+    QVERIFY(waitForSignal(&batchFinishedSpy));
+    QCOMPARE(batchFinishedSpy.count(), 1);
+    QCOMPARE(batchFinishedSpy.at(0).at(0).value<QList<quint32> >(), ids);
+    QCOMPARE(eventPlayingSpy.count(), 3);
+
+    QTRY_COMPARE(playCalledSpy.count(), 3);
+    QCOMPARE(playCalledSpy.at(1).at(0).toString(), QString("a-batch-event-2"));
+    QCOMPARE(playCalledSpy.at(1).at(1).toMap(), properties);
+
+    SignalSpy eventCompletedSpy(m_client, SIGNAL(eventCompleted(quint32)));
+
+    foreach (quint32 id, ids) {
+        QVERIFY(m_client->stop(id));
+    }
+
+    QTRY_COMPARE(eventCompletedSpy.count(), 3);
+}
+
+void UtClient::testPrivateConnection()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    Client client;
+
+    // The system bus of the tests is the session bus
+    QVERIFY(client.openPrivateConnection(Client::SessionBus, "ut_client-private"));
+    QVERIFY(client.connect());
+
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    quint32 id = client.play("a-private-event");
+    QVERIFY(id > 0);
+
+    QVERIFY(waitForSignals(SignalSpyList() << &playCalledSpy << &eventPlayingSpy));
+    QCOMPARE(playCalledSpy.at(0).at(0).toString(), QString("a-private-event"));
+
+    // Too late to switch connections with an event around
+    QVERIFY(!client.openPrivateConnection(Client::SessionBus, "ut_client-private2"));
+
+    QVERIFY(client.stop(id));
+
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), id);
+}
+
+void UtClient::testPeerConnection()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    Client missing;
+    QVERIFY(!missing.openPeerConnection("unix:path=/nonexistent/ngfd/peer"));
+
+    Client client;
+
+    QVERIFY(client.openPeerConnection(peerAddress()));
+    QVERIFY(client.connect());
+
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    quint32 id = client.play("a-peer-event");
+    QVERIFY(id > 0);
+
+    QVERIFY(waitForSignals(SignalSpyList() << &playCalledSpy << &eventPlayingSpy));
+    QCOMPARE(playCalledSpy.at(0).at(0).toString(), QString("a-peer-event"));
+    QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), id);
+
+    QVERIFY(client.stop(id));
+
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), id);
+}
+
+void UtClient::testLoopback()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    Client client;
+
+    QVERIFY(client.openLoopback(0, 0, 100));
+    QVERIFY(!client.openPeerConnection(peerAddress()));
+    QVERIFY(!client.openPrivateConnection(Client::SessionBus, "ngf-qt-ut-loopback"));
+    QVERIFY(client.connect());
+    QVERIFY(!client.openLoopback());
+
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventPausedSpy(&client, SIGNAL(eventPaused(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    quint32 id = client.play("a-loopback-event");
+    QVERIFY(id > 0);
+
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), id);
+
+    QVERIFY(client.pause(id));
+
+    QVERIFY(waitForSignal(&eventPausedSpy));
+    QCOMPARE(eventPausedSpy.at(0).at(0).toUInt(), id);
+
+    // Event completes on its own once its duration is up
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), id);
+
+    quint32 stopped = client.play("a-loopback-event");
+    eventPlayingSpy.clear();
+    eventCompletedSpy.clear();
+
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QVERIFY(client.stop(stopped));
+
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), stopped);
+
+    // Nothing went to the daemon
+    QCOMPARE(playCalledSpy.count(), 0);
+    QCOMPARE(client.statistics().value("eventSlotsInUse").toInt(), 0);
+}
+
+void UtClient::testPlayFromThreads()
+{
+    Client client;
+    QVERIFY(client.connect());
+
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    PlayerThread first(&client, "a-threaded-event-a-", THREADED_EVENTS);
+    PlayerThread second(&client, "a-threaded-event-b-", THREADED_EVENTS);
+
+    first.start();
+    second.start();
+    QVERIFY(first.wait(SIGNAL_WAIT_TIMEOUT));
+    QVERIFY(second.wait(SIGNAL_WAIT_TIMEOUT));
+
+    // Ids were handed out without the client thread taking part, yet they are unique
+    QSet<quint32> ids;
+    foreach (quint32 id, first.ids + second.ids) {
+        QVERIFY(id > 0);
+        ids.insert(id);
+    }
+    QCOMPARE(ids.size(), 2 * THREADED_EVENTS);
+
+    QTRY_COMPARE_WITH_TIMEOUT(eventCompletedSpy.count(), 2 * THREADED_EVENTS, SIGNAL_WAIT_TIMEOUT);
+
+    foreach (const QList<QVariant> &arguments, eventCompletedSpy) {
+        QVERIFY(ids.remove(arguments.at(0).toUInt()));
+    }
+
+    QCOMPARE(client.statistics().value("queuedCalls").toInt(), 4 * THREADED_EVENTS);
+}
+
+void UtClient::testDispatcherThread()
+{
+    Client client;
+
+    QVERIFY(client.startDispatcherThread());
+    QVERIFY(!client.openPeerConnection(peerAddress()));
+    QVERIFY(client.connect());
+    QVERIFY(client.isConnected());
+
+    QThread *emittingThread = 0;
+    QList<quint32> playing;
+    QList<quint32> completed;
+
+    QObject::connect(&client, &Client::eventPlaying, [&emittingThread]() {
+        emittingThread = QThread::currentThread();
+    });
+    QObject::connect(&client, &Client::eventPlaying, this, [&playing](quint32 id) {
+        playing.append(id);
+    });
+    QObject::connect(&client, &Client::eventCompleted, this, [&completed](quint32 id) {
+        completed.append(id);
+    });
+
+    quint32 id = client.play("a-dispatched-event");
+    QVERIFY(id > 0);
+
+    // Delivered to this thread, but handled in the dispatcher thread
+    QTRY_COMPARE_WITH_TIMEOUT(playing.size(), 1, SIGNAL_WAIT_TIMEOUT);
+    QCOMPARE(playing.at(0), id);
+    QVERIFY(emittingThread != 0);
+    QVERIFY(emittingThread != QThread::currentThread());
+
+    QVERIFY(client.stop(id));
+
+    QTRY_COMPARE_WITH_TIMEOUT(completed.size(), 1, SIGNAL_WAIT_TIMEOUT);
+    QCOMPARE(completed.at(0), id);
+    QTRY_COMPARE(client.statistics().value("eventSlotsInUse").toInt(), 0);
+}
+
+void UtClient::testStatusSubscription()
+{
+    QDBusInterface mockService(service(), path(), interface(), bus());
+
+    Client idle;
+    QVERIFY(idle.connect());
+    QCOMPARE(idle.statistics().value("statusSubscribed").toBool(), false);
+
+    Client client;
+    QVERIFY(client.connect());
+
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventPausedSpy(&client, SIGNAL(eventPaused(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    // Nothing is set up before there is something to send
+    quint32 id = client.play("a-subscribing-event");
+    QCOMPARE(client.statistics().value("statusSubscribed").toBool(), false);
+
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QCOMPARE(client.statistics().value("statusSubscribed").toBool(), true);
+    QVERIFY(client.pause(id));
+    QVERIFY(waitForSignal(&eventPausedSpy));
+    QVERIFY(client.stop(id));
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+
+    QVariantMap statistics = client.statistics();
+    QCOMPARE(statistics.value("statusReceived").toInt(), 2);
+    QCOMPARE(statistics.value("statusMatched").toInt(), 2);
+
+    // Client without events doesn't hear about the events of others
+    QCOMPARE(idle.statistics().value("statusReceived").toInt(), 0);
+
+    // Subscription is dropped once the client has been idle for a while
+    QTRY_COMPARE_WITH_TIMEOUT(client.statistics().value("statusSubscribed").toBool(), false,
+                              SIGNAL_WAIT_TIMEOUT);
+
+    SignalSpy idleCompletedSpy(&idle, SIGNAL(eventCompleted(quint32)));
+    QVERIFY(idle.play("an-unrelated-event") > 0);
+    QVERIFY(waitForSignal(&idle, SIGNAL(eventPlaying(quint32))));
+    QVERIFY(idle.stop("an-unrelated-event"));
+    QVERIFY(waitForSignal(&idleCompletedSpy));
+
+    QCOMPARE(client.statistics().value("statusReceived").toInt(), 2);
+}
+
+void UtClient::testWarmUp()
+{
+    Client client;
+
+    SignalSpy readySpy(&client, SIGNAL(ready()));
+    SignalSpy connectionStatusSpy(&client, SIGNAL(connectionStatus(bool)));
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    // Warming up happens from the event loop
+    client.warmUp(true);
+    QCOMPARE(readySpy.count(), 0);
+
+    QVERIFY(waitForSignal(&readySpy));
+    QCOMPARE(connectionStatusSpy.count(), 1);
+    QCOMPARE(connectionStatusSpy.at(0).at(0).toBool(), true);
+    QVERIFY(client.isConnected());
+
+    quint32 id = client.play("a-warm-event");
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), id);
+
+    QVERIFY(client.stop(id));
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+
+    // Warming up before NGFD is on the bus gets ready once it registers
+    const QString mockOwner = bus().interface()->serviceOwner(service()).value();
+    QDBusInterface mockService(mockOwner, path(), interface(), bus());
+
+    mockService.call("mock_unregister");
+    QTRY_VERIFY(!bus().interface()->isServiceRegistered(service()).value());
+
+    Client bootClient;
+
+    SignalSpy bootReadySpy(&bootClient, SIGNAL(ready()));
+    SignalSpy bootConnectionStatusSpy(&bootClient, SIGNAL(connectionStatus(bool)));
+
+    bootClient.warmUp();
+    QTest::qWait(100);
+    QCOMPARE(bootReadySpy.count(), 0);
+    QVERIFY(!bootClient.isConnected());
+
+    mockService.call("mock_register");
+    QVERIFY(waitForSignal(&bootReadySpy));
+    QVERIFY(bootClient.isConnected());
+    QCOMPARE(bootConnectionStatusSpy.last().at(0).toBool(), true);
+}
+
+void UtClient::testOfflineQueue()
+{
+    // Mock stays reachable by its unique name while the well-known one is gone
+    const QString mockOwner = bus().interface()->serviceOwner(service()).value();
+    QDBusInterface mockService(mockOwner, path(), interface(), bus());
+
+    Client client;
+
+    SignalSpy readySpy(&client, SIGNAL(ready()));
+    SignalSpy connectionStatusSpy(&client, SIGNAL(connectionStatus(bool)));
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventFailedSpy(&client, SIGNAL(eventFailed(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+    SignalSpy playCalledSpy(&mockService, SIGNAL(mock_playCalled(QString,QVariantMap)));
+
+    client.warmUp();
+    QVERIFY(waitForSignal(&readySpy));
+    connectionStatusSpy.clear();
+
+    mockService.call("mock_unregister");
+    QVERIFY(waitForSignal(&connectionStatusSpy));
+    QCOMPARE(connectionStatusSpy.at(0).at(0).toBool(), false);
+
+    // Held back without anything being sent or failing, one shots are dropped
+    quint32 id = client.play("an-offline-event");
+    QVERIFY(!client.playOneShot("an-offline-one-shot-event"));
+    QTest::qWait(100);
+    QCOMPARE(playCalledSpy.count(), 0);
+    QCOMPARE(eventFailedSpy.count(), 0);
+    QCOMPARE(client.statistics().value("offlineQueued").toUInt(), 1u);
+
+    // Stopping a held back event completes it later, not from within stop()
+    quint32 stoppedId = client.play("a-stopped-offline-event");
+    QTRY_COMPARE(client.statistics().value("offlineQueued").toUInt(), 2u);
+    QVERIFY(client.stop(stoppedId));
+    QCOMPARE(eventCompletedSpy.count(), 0);
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QCOMPARE(eventCompletedSpy.at(0).at(0).toUInt(), stoppedId);
+    eventCompletedSpy.clear();
+
+    // Played as soon as NGFD is back
+    mockService.call("mock_register");
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), id);
+    QCOMPARE(playCalledSpy.count(), 1);
+    QCOMPARE(playCalledSpy.at(0).at(0).toString(), QString("an-offline-event"));
+
+    QVERIFY(client.stop(id));
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+
+    connectionStatusSpy.clear();
+    mockService.call("mock_unregister");
+    QVERIFY(waitForSignal(&connectionStatusSpy));
+
+    // Oldest one gives way when the queue is full, the rest fail once they have waited too long
+    QList<quint32> ids;
+    for (int i = 0; i <= OFFLINE_QUEUE_LIMIT; ++i)
+        ids.append(client.play(QString("an-offline-event-%1").arg(i)));
+
+    QVERIFY(waitForSignal(&eventFailedSpy));
+    QCOMPARE(eventFailedSpy.count(), 1);
+    QCOMPARE(eventFailedSpy.at(0).at(0).toUInt(), ids.first());
+
+    QTRY_COMPARE_WITH_TIMEOUT(eventFailedSpy.count(), ids.size(), 2 * OFFLINE_QUEUE_TIMEOUT);
+    QCOMPARE(eventFailedSpy.at(1).at(0).toUInt(), ids.at(1));
+    QCOMPARE(playCalledSpy.count(), 1);
+    QCOMPARE(client.statistics().value("offlineDropped").toInt(), ids.size());
+    QCOMPARE(client.statistics().value("eventSlotsInUse").toInt(), 0);
+
+    mockService.call("mock_register");
+    QVERIFY(waitForService(service()));
+}
+
+void UtClient::testServiceLost()
+{
+    // Mock stays reachable by its unique name while the well-known one is gone
+    const QString mockOwner = bus().interface()->serviceOwner(service()).value();
+    QDBusInterface mockService(mockOwner, path(), interface(), bus());
+
+    Client client;
+
+    SignalSpy readySpy(&client, SIGNAL(ready()));
+    SignalSpy connectionStatusSpy(&client, SIGNAL(connectionStatus(bool)));
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventFailedSpy(&client, SIGNAL(eventFailed(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    client.warmUp();
+    QVERIFY(waitForSignal(&readySpy));
+
+    quint32 running = client.play("a-running-event");
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    eventPlayingSpy.clear();
+
+    // Only a few background events are let out at a time, the rest are still staged when
+    // NGFD goes away
+    QList<quint32> staged;
+    for (int i = 0; i < 10; ++i)
+        staged.append(client.play(QString("a-staged-event-%1").arg(i), QVariantMap(),
+                                  Client::BackgroundPriority));
+
+    connectionStatusSpy.clear();
+    mockService.call("mock_unregister");
+    QVERIFY(waitForSignal(&connectionStatusSpy));
+    QCOMPARE(connectionStatusSpy.at(0).at(0).toBool(), false);
+
+    // The running event is gone together with NGFD, the others are held back
+    QTRY_COMPARE(eventFailedSpy.count(), 1);
+    QCOMPARE(eventFailedSpy.at(0).at(0).toUInt(), running);
+    QTRY_COMPARE(client.statistics().value("offlineQueued").toInt(), staged.size());
+    QCOMPARE(client.statistics().value("eventSlotsInUse").toInt(), staged.size());
+
+    mockService.call("mock_register");
+    QVERIFY(waitForService(service()));
+
+    QTRY_COMPARE(eventPlayingSpy.count(), staged.size());
+    for (int i = 0; i < staged.size(); ++i)
+        QCOMPARE(eventPlayingSpy.at(i).at(0).toUInt(), staged.at(i));
+    QCOMPARE(eventFailedSpy.count(), 1);
+
+    foreach (quint32 id, staged)
+        QVERIFY(client.stop(id));
+    QTRY_COMPARE(eventCompletedSpy.count(), staged.size());
+    QCOMPARE(client.statistics().value("eventSlotsInUse").toInt(), 0);
+}
+
+void UtClient::testDeadlines()
+{
+    Client client;
+
+    QVERIFY(client.openLoopback(100, 0, -1));
+    QVERIFY(client.connect());
+
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventFailedSpy(&client, SIGNAL(eventFailed(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+    SignalSpy batchFinishedSpy(&client, SIGNAL(batchFinished(QList<quint32>)));
+
+    // Plenty of time
+    quint32 id = client.play("a-timely-event", QVariantMap(), 1000);
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), id);
+    QVERIFY(client.stop(id));
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+
+    // Deadline passes before the event loop gets to dispatch it
+    eventPlayingSpy.clear();
+    id = client.play("a-stale-event", QVariantMap(), 1);
+    QTest::qSleep(10);
+    QVERIFY(waitForSignal(&eventFailedSpy));
+    QCOMPARE(eventFailedSpy.at(0).at(0).toUInt(), id);
+    QCOMPARE(client.statistics().value("deadlineDropped").toInt(), 1);
+
+    // Deadline passes while waiting for the reply, failure is reported right then
+    eventFailedSpy.clear();
+    QElapsedTimer timer;
+    timer.start();
+    id = client.play("a-slow-event", QVariantMap(), 20);
+    QVERIFY(waitForSignal(&eventFailedSpy));
+    QCOMPARE(eventFailedSpy.at(0).at(0).toUInt(), id);
+    QVERIFY(timer.elapsed() < 100);
+    QCOMPARE(client.statistics().value("deadlineDropped").toInt(), 2);
+
+    // Late reply doesn't bring the event back
+    QTest::qWait(150);
+    QCOMPARE(eventPlayingSpy.count(), 0);
+    QCOMPARE(client.statistics().value("eventSlotsInUse").toInt(), 0);
+
+    // Batch finishes also when some of it is dropped
+    eventFailedSpy.clear();
+    QList<quint32> ids = client.playBatch(QList<EventRequest>()
+                                          << EventRequest("a-batched-event")
+                                          << EventRequest("a-stale-batched-event", QVariantMap(), 1));
+    QTest::qSleep(10);
+    QVERIFY(waitForSignal(&batchFinishedSpy));
+    QCOMPARE(batchFinishedSpy.at(0).at(0).value<QList<quint32> >(), ids);
+    QCOMPARE(eventFailedSpy.count(), 1);
+    QCOMPARE(eventFailedSpy.at(0).at(0).toUInt(), ids.at(1));
+    QCOMPARE(eventPlayingSpy.count(), 1);
+    QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), ids.at(0));
+    QCOMPARE(client.statistics().value("deadlineDropped").toInt(), 3);
+}
+
+void UtClient::testRateLimit()
+{
+    Client client;
+
+    QVERIFY(client.openLoopback());
+    QVERIFY(client.connect());
+
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+
+    client.setRateLimit("a-limited-event", 10000, 2);
+
+    // Burst goes through, the rest is suppressed until tokens are earned back
+    quint32 first = client.play("a-limited-event");
+    quint32 second = client.play("a-limited-event");
+    QVERIFY(first != Client::SuppressedEventId);
+    QVERIFY(second != Client::SuppressedEventId);
+    QCOMPARE(client.play("a-limited-event"), quint32(Client::SuppressedEventId));
+    QVERIFY(!client.playOneShot("a-limited-event"));
+
+    // Other events aren't affected
+    quint32 other = client.play("an-unlimited-event");
+    QVERIFY(other != Client::SuppressedEventId);
+
+    QList<quint32> ids = client.playBatch(QList<EventRequest>()
+                                          << EventRequest("a-limited-event")
+                                          << EventRequest("an-unlimited-event"));
+    QCOMPARE(ids.at(0), quint32(Client::SuppressedEventId));
+    QVERIFY(ids.at(1) != Client::SuppressedEventId);
+
+    QTRY_COMPARE(eventPlayingSpy.count(), 4);
+    QCOMPARE(client.statistics().value("suppressedCalls").toInt(), 3);
+
+    // Limit can be lifted
+    client.setRateLimit("a-limited-event", 0);
+    QVERIFY(client.play("a-limited-event") != Client::SuppressedEventId);
+    QTRY_COMPARE(eventPlayingSpy.count(), 5);
+    QCOMPARE(client.statistics().value("suppressedCalls").toInt(), 3);
+}
+
+void UtClient::testPriorities()
+{
+    Client client;
+
+    QVERIFY(client.openLoopback());
+    QVERIFY(client.connect());
+
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+
+    QList<quint32> background;
+    for (int i = 0; i < 10; ++i)
+        background.append(client.play(QString("a-background-event-%1").arg(i), QVariantMap(),
+                                      Client::BackgroundPriority));
+    quint32 normal = client.play("a-normal-event");
+    quint32 realtime = client.play("a-realtime-event", QVariantMap(), Client::RealtimePriority);
+
+    QVariantMap stats = client.statistics();
+    QCOMPARE(stats.value("stagedRealtime").toInt(), 1);
+    QCOMPARE(stats.value("stagedNormal").toInt(), 1);
+    QCOMPARE(stats.value("stagedBackground").toInt(), 10);
+
+    // Realtime goes first, background last and a few at a time
+    QTRY_COMPARE(eventPlayingSpy.count(), 12);
+    QCOMPARE(eventPlayingSpy.at(0).at(0).toUInt(), realtime);
+    QCOMPARE(eventPlayingSpy.at(1).at(0).toUInt(), normal);
+    for (int i = 0; i < background.size(); ++i)
+        QCOMPARE(eventPlayingSpy.at(2 + i).at(0).toUInt(), background.at(i));
+
+    stats = client.statistics();
+    QCOMPARE(stats.value("stagedBackground").toInt(), 0);
+    QCOMPARE(stats.value("stagedPeakBackground").toInt(), 10);
+    QCOMPARE(stats.value("backgroundCalls").toInt(), 0);
+}
+
+void UtClient::testTimelines()
+{
+    Client client;
+
+    QVERIFY(client.openLoopback(20, 0, 30));
+    QVERIFY(client.connect());
+
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    // Nothing is recorded unless asked for
+    quint32 id = client.play("an-untimed-event");
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QVERIFY(client.timeline(id).isEmpty());
+    QVERIFY(client.latencies().isEmpty());
+
+    eventCompletedSpy.clear();
+    client.setTimelinesEnabled(true);
+    id = client.play("a-timed-event");
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+
+    // Loopback delays are in whole milliseconds of its own clock
+    QVariantMap timeline = client.timeline(id);
+    QCOMPARE(timeline.value("event").toString(), QString("a-timed-event"));
+    QVERIFY(timeline.value("played").toLongLong() <= timeline.value("sent").toLongLong());
+    QVERIFY(timeline.value("sent").toLongLong() + 19000 <= timeline.value("replied").toLongLong());
+    QVERIFY(timeline.value("serverEventId").toUInt() > 0);
+
+    QVariantList status = timeline.value("status").toList();
+    QCOMPARE(status.size(), 1);
+    QCOMPARE(status.at(0).toMap().value("state").toUInt(), 1u);  // completed
+    QVERIFY(status.at(0).toMap().value("time").toLongLong()
+            >= timeline.value("replied").toLongLong() + 29000);
+
+    QVariantMap latencies = client.latencies().value("a-timed-event").toMap();
+    QCOMPARE(latencies.keys(), QStringList() << "dispatch" << "reply" << "start" << "status");
+    QVariantMap start = latencies.value("start").toMap();
+    QCOMPARE(start.value("samples").toInt(), 1);
+    QVERIFY(start.value("p50").toLongLong() >= 19000);
+    QCOMPARE(start.value("p99"), start.value("p50"));
+}
+
+void UtClient::testClientStats()
+{
+    Client client;
+
+    QVERIFY(client.openLoopback(0, 0, 0));
+    QVERIFY(client.connect());
+
+    ClientStats *stats = client.stats();
+    QVERIFY(stats);
+    QCOMPARE(client.stats(), stats);
+    QCOMPARE(stats->playsIssued(), 0ull);
+
+    SignalSpy changedSpy(stats, SIGNAL(changed()));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    for (int i = 0; i < 3; ++i)
+        QVERIFY(client.play("an-event") > 0);
+    QVERIFY(client.playOneShot("a-one-shot-event"));
+
+    QTRY_COMPARE(eventCompletedSpy.count(), 3);
+    QTRY_COMPARE(stats->completions(), 3ull);
+    QVERIFY(changedSpy.count() > 0);
+
+    QCOMPARE(stats->playsIssued(), 4ull);
+    QCOMPARE(stats->replies(), 3ull);
+    QCOMPARE(stats->failures(), 0ull);
+    QCOMPARE(stats->failuresByReason().keys(),
+             QStringList() << "deadline" << "offline" << "reply" << "status");
+    QCOMPARE(stats->eventsInFlight(), 0);
+    QCOMPARE(stats->eventsInFlightPeak(), 3);
+    QCOMPARE(stats->pendingCalls(), 0);
+
+    // Loopback never marshals anything
+    QCOMPARE(stats->bytesMarshalled(), 0ull);
+}
+
+void UtClient::testRecording()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.path() + "/client.trace";
+
+    Client client;
+
+    QVERIFY(client.openLoopback());
+    QVERIFY(client.connect());
+
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventPausedSpy(&client, SIGNAL(eventPaused(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    QVERIFY(client.startRecording(fileName));
+
+    QVariantMap properties;
+    properties.insert("media.audio", true);
+    quint32 id = client.play("a-recorded-event", properties);
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QVERIFY(client.pause(id));
+    QVERIFY(waitForSignal(&eventPausedSpy));
+    QVERIFY(client.resume("a-recorded-event"));
+    QTRY_COMPARE(eventPlayingSpy.count(), 2);
+    QVERIFY(client.stop(id));
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+    QVERIFY(client.playOneShot("a-recorded-one-shot-event"));
+
+    QVERIFY(client.stopRecording());
+    QVERIFY(client.play("an-unrecorded-event") > 0);
+
+    TraceReader reader;
+    QVERIFY(reader.open(fileName));
+
+    QList<TraceRecord> records;
+    TraceRecord record;
+    while (reader.next(&record))
+        records.append(record);
+
+    QCOMPARE(records.size(), 9);
+
+    QCOMPARE(records.at(0).type, TraceRecord::Play);
+    QCOMPARE(records.at(0).eventId, id);
+    QCOMPARE(records.at(0).event, QString("a-recorded-event"));
+    QCOMPARE(records.at(0).properties, properties);
+    QCOMPARE(records.at(0).priority, int(Client::NormalPriority));
+
+    QCOMPARE(records.at(1).type, TraceRecord::Reply);
+    QCOMPARE(records.at(1).eventId, id);
+    QVERIFY(records.at(1).ok);
+    const quint32 serverEventId = records.at(1).serverEventId;
+    QVERIFY(serverEventId > 0);
+
+    QCOMPARE(records.at(2).type, TraceRecord::Pause);
+    QCOMPARE(records.at(2).eventId, id);
+    QCOMPARE(records.at(3).type, TraceRecord::Status);
+    QCOMPARE(records.at(3).serverEventId, serverEventId);
+    QCOMPARE(records.at(3).state, 3u);  // paused
+    QCOMPARE(records.at(3).eventId, id);
+
+    // Requests by name are recorded by name
+    QCOMPARE(records.at(4).type, TraceRecord::Resume);
+    QCOMPARE(records.at(4).eventId, 0u);
+    QCOMPARE(records.at(4).event, QString("a-recorded-event"));
+    QCOMPARE(records.at(5).type, TraceRecord::Status);
+    QCOMPARE(records.at(5).state, 2u);  // playing
+
+    QCOMPARE(records.at(6).type, TraceRecord::Stop);
+    QCOMPARE(records.at(7).type, TraceRecord::Status);
+    QCOMPARE(records.at(7).state, 1u);  // completed
+
+    QCOMPARE(records.at(8).type, TraceRecord::PlayOneShot);
+    QCOMPARE(records.at(8).event, QString("a-recorded-one-shot-event"));
+
+    for (int i = 1; i < records.size(); ++i)
+        QVERIFY(records.at(i - 1).time <= records.at(i).time);
+
+    // Trace that can't be written out is reported when recording stops
+    if (QFile::exists("/dev/full")) {
+        QVERIFY(client.startRecording("/dev/full"));
+        QVERIFY(client.playOneShot("an-unwritten-one-shot-event"));
+        QVERIFY(!client.stopRecording());
+    }
+}
+
+void UtClient::testFlightRecorder()
+{
+    Client client;
+
+    QVERIFY(client.openLoopback());
+    QVERIFY(client.connect());
+
+    SignalSpy eventPlayingSpy(&client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventCompletedSpy(&client, SIGNAL(eventCompleted(quint32)));
+
+    quint32 id = client.play("a-recorded-event");
+    QVERIFY(waitForSignal(&eventPlayingSpy));
+    QVERIFY(client.stop(id));
+    QVERIFY(waitForSignal(&eventCompletedSpy));
+
+    // <time> <operation> <client event id> <server event id> <value>
+    QStringList operations;
+    qint64 previous = 0;
+    foreach (const QString &line, client.dumpFlightRecorder().trimmed().split('\n')) {
+        const QStringList fields = line.split(' ');
+        QCOMPARE(fields.size(), 5);
+        QVERIFY(fields.at(0).toLongLong() >= previous);
+        previous = fields.at(0).toLongLong();
+        if (fields.at(2).toUInt() == id)
+            operations << fields.at(1) + ' ' + fields.at(4);
+    }
+
+    QCOMPARE(operations, QStringList()
+             << "play 1"        // normal priority
+             << "dispatch 0"
+             << "reply 1"
+             << "stop 0"
+             << "request 3"     // stopped
+             << "status 1");    // completed
+
+    // Oldest are overwritten
+    for (int i = 0; i < FLIGHT_RECORDER_CAPACITY; ++i)
+        QVERIFY(client.playOneShot("a-one-shot-event"));
+    const QStringList lines = client.dumpFlightRecorder().trimmed().split('\n');
+    QCOMPARE(lines.size(), int(FLIGHT_RECORDER_CAPACITY));
+    QCOMPARE(lines.filter(" play-one-shot ").size(), int(FLIGHT_RECORDER_CAPACITY));
+}
+
+void UtClient::testEventSlotReuse()
+{
+    // All events of the previous test cases are finished by now
+    QVariantMap statistics = m_client->statistics();
+    QCOMPARE(statistics.value("eventSlotsInUse").toInt(), 0);
+
+    const int eventSlots = statistics.value("eventSlots").toInt();
+    QVERIFY(eventSlots > 0);
+
+    SignalSpy eventPlayingSpy(m_client, SIGNAL(eventPlaying(quint32)));
+    SignalSpy eventCompletedSpy(m_client, SIGNAL(eventCompleted(quint32)));
+
+    // Every round goes through NGFD, so that slots and their reply trackers are reused
+    // across replies instead of the plays being elided
+    for (int i = 0; i < eventSlots; ++i) {
+        QVERIFY(m_client->play("an-event") > 0);
+        QVERIFY(waitForSignal(&eventPlayingSpy));
+        QVERIFY(m_client->stop("an-event"));
+
+        QVERIFY(waitForSignal(&eventCompletedSpy));
+        eventPlayingSpy.clear();
+        eventCompletedSpy.clear();
+    }
+
+    statistics = m_client->statistics();
+    QCOMPARE(statistics.value("eventSlotsInUse").toInt(), 0);
+    QCOMPARE(statistics.value("eventSlots").toInt(), eventSlots);
+}
+
 TEST_MAIN(UtClient)
 
 #include "ut_client.moc"